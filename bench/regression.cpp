@@ -0,0 +1,1025 @@
+#ifndef IOSTREAM
+#define IOSTREAM
+#include <iostream>
+#endif
+
+#ifndef FSTREAM
+#define FSTREAM
+#include <fstream>
+#endif
+
+#ifndef SSTREAM
+#define SSTREAM
+#include <sstream>
+#endif
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef FILESYSTEM
+#define FILESYSTEM
+#include <filesystem>
+#endif
+
+#ifndef UNORDERED_SET
+#define UNORDERED_SET
+#include <unordered_set>
+#endif
+
+#ifndef SET
+#define SET
+#include <set>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef CHRONO
+#define CHRONO
+#include <chrono>
+#endif
+
+#ifndef RANDOM
+#define RANDOM
+#include <random>
+#endif
+
+#ifndef OPTIONAL
+#define OPTIONAL
+#include <optional>
+#endif
+
+#ifndef MAP
+#define MAP
+#include <map>
+#endif
+
+#ifndef LIMITS
+#define LIMITS
+#include <limits>
+#endif
+
+#ifndef IOMANIP
+#define IOMANIP
+#include <iomanip>
+#endif
+
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+#include <boost/program_options.hpp>
+
+#include "FileProcess.hpp"
+#include "TextPreprocess.hpp"
+#include "Rake.hpp"
+#include "TextRank.hpp"
+#include "HierarchicalTextRank.hpp"
+#include "Planner.hpp"
+#include "Parallel.hpp"
+#include "StreamingRake.hpp"
+#include "Deduplication.hpp"
+#include "Pipeline.hpp"
+
+#include "reference/ReferenceTextPreprocess.hpp"
+#include "reference/ReferenceRake.hpp"
+#include "reference/ReferenceTextRank.hpp"
+
+// Differential test and benchmark of the optimized engines against the original implementation
+// The reference copies in bench/reference are the oracle: every optimized stage has to reproduce
+// their output and must not be slower than max-slowdown times the reference
+
+using strVec = std::vector<std::string>;
+using phraseVector = std::vector< strVec >;
+
+constexpr char PATH_SEP = std::filesystem::path::preferred_separator;
+const std::string STOP_CHARS_PATH = "resources" + std::string(1, PATH_SEP) + "stopchars.txt";
+const std::string STOP_WORDS_PATH = "resources" + std::string(1, PATH_SEP) + "stopwords.txt";
+
+const std::unordered_set<char> sent_end_chars = {'.', '!', '?', ';', ':'};
+
+struct Harness_Config {
+    std::string inputs_dir = "inputs";
+    size_t generated = 3;
+    size_t generated_sentences = 2000;
+    unsigned int seed = 42;
+    size_t repeat = 3;
+    size_t threads = 1;
+    size_t max_sentences = 0;   // 0 = no limit
+    double max_slowdown = 1.25;
+    double min_time_ms = 2.0;
+    double tolerance = 1e-6;
+    double max_misestimate = 4;
+};
+
+struct Corpus {
+    std::string name;
+    std::string text;
+};
+
+struct Stage_Timing {
+    std::string stage;
+    double reference_ms;
+    double optimized_ms;
+};
+
+class Harness {
+    const Harness_Config& config_;
+    const std::unordered_set<char>& stop_chars_;
+    const std::unordered_set<std::string>& stop_words_;
+    std::vector<std::string> failures_;
+
+public:
+    Harness(const Harness_Config& config, const std::unordered_set<char>& stop_chars,
+            const std::unordered_set<std::string>& stop_words)
+            : config_(config), stop_chars_(stop_chars), stop_words_(stop_words) {}
+
+    // Runs all the differential checks and timings on a single corpus, prints a report
+    void run(const Corpus& corpus);
+
+    // Checks of single components on small inputs with known results, failures are reported under "fixed cases"
+    void run_fixed_cases();
+
+    [[nodiscard]] const std::vector<std::string>& failures() const { return failures_; }
+
+private:
+    // Calls fn repeat times, returns the best time in milliseconds, result holds the output of the last call
+    template <typename Result, typename Fn>
+    double best_time(Result& result, Fn&& fn) const {
+        double best = std::numeric_limits<double>::max();
+        for (size_t r = 0; r < config_.repeat; r++) {
+            auto start = std::chrono::steady_clock::now();
+            result = fn();
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    }
+
+    void fail(const Corpus& corpus, const std::string& what) {
+        failures_.push_back(corpus.name + ": " + what);
+    }
+
+    // The summary selections may only differ in sentences whose reference scores are within tolerance of the cut
+    bool same_selection(const std::vector<double>& ref_scores, const strVec& ref_summary,
+                        const strVec& opt_summary) const;
+
+    void report(const Corpus& corpus, size_t num_sentences, const std::vector<Stage_Timing>& timings,
+                const std::string& note = "");
+
+    // Scores have to match the reference within tolerance, returns false after recording the first difference
+    bool same_scores(const Corpus& corpus, const std::string& engine, const std::vector<double>& ref_scores,
+                     const std::vector<double>& opt_scores);
+
+    // An exception of a block has to reach the caller of for_each_block once all threads are done,
+    // the team stays usable for the next round
+    void check_throwing_blocks(const Corpus& fixed);
+
+    // Frequent phrases of a stream with more distinct phrases than the capacity have to stay monitored,
+    // count - error and the sketch estimates have to bound the true counts from below and above
+    void check_streaming_counts(const Corpus& fixed);
+
+    // Known groups of duplicates have to collapse into their first sentence in document order,
+    // distinct sentences and sentences without tokens are kept
+    void check_deduplication(const Corpus& fixed);
+
+    // A phrase joined by a stop word often enough becomes a candidate scored by its content words and counts
+    // as a phrase, a version 2 snapshot keeps the adjoined counts through serialize and deserialize
+    void check_adjoined_phrases(const Corpus& fixed);
+
+    // Every similarity policy has to give the similarities of its formula worked out by hand on a tiny corpus,
+    // and the recorded ranking and scores of a small text
+    void check_similarity_policies(const Corpus& fixed);
+
+    template <typename SimilarityPolicy>
+    void check_golden_ranking(const Corpus& fixed, const std::string& engine, const std::vector<size_t>& ranking,
+                              const std::vector<double>& scores);
+
+    // A snapshot whose counts do not match its contents has to throw std::runtime_error
+    void check_malformed_snapshots(const Corpus& fixed);
+
+    // The graph built by the pipeline (--pipeline) has to give the scores of the batch constructor,
+    // for an incremental and a whole-corpus similarity and for queues of one sentence and of the default capacity
+    template <typename TextRank_Type>
+    void check_pipelined(const Corpus& corpus, const std::string& engine, const strVec& sentences,
+                         const phraseVector& processed);
+
+    // Lazy convergence (--lazy-convergence) has to select the summaries of the fully converged Jacobi iteration
+    template <typename TextRank_Type>
+    void check_lazy(const Corpus& corpus, const std::string& engine, const strVec& sentences,
+                    const phraseVector& processed, const std::vector<int>& lengths);
+
+    // Hierarchical TextRank of a single section has to give the summaries of plain TextRank,
+    // also with node weights and with lazy convergence
+    void check_single_section(const Corpus& corpus, const strVec& sentences, const phraseVector& processed,
+                              const std::vector<int>& lengths);
+
+    // An exception of the ranker has to stop the pipeline and reach the caller, whatever the queue capacity
+    void check_pipeline_errors(const Corpus& fixed);
+
+    // Runs the first plan of every strategy of the planner, none may take longer than max-misestimate times its estimate
+    void check_plans(const Corpus& corpus, const strVec& sentences, const phraseVector& processed);
+};
+
+// Scores of the default overlap similarity (distinct shared words / (log|S1| + log|S2|), zero denominators
+// leave the pair out) written out pair by pair, iterated in place like the reference
+std::vector<double> overlap_oracle_scores(const phraseVector& tokenized_sentences) {
+    size_t size = tokenized_sentences.size();
+    std::vector< std::set<std::string> > words;
+    for (const auto& sentence : tokenized_sentences) {
+        words.emplace_back(sentence.begin(), sentence.end());
+    }
+    std::vector< std::vector< std::pair<size_t, double> > > edges(size);
+    for (size_t i = 0; i < size; i++) {
+        for (size_t j = i + 1; j < size; j++) {
+            double bottom = std::log(tokenized_sentences[i].size()) + std::log(tokenized_sentences[j].size());
+            if (!(bottom > 0)) {
+                continue;
+            }
+            double top = 0;
+            for (const auto& word : words[i]) {
+                top += words[j].count(word);
+            }
+            if (std::abs(top / bottom) >= 1e-9) {
+                edges[i].emplace_back(j, top / bottom);
+                edges[j].emplace_back(i, top / bottom);
+            }
+        }
+    }
+    std::vector<double> norm(size, 1);
+    for (size_t i = 0; i < size; i++) {
+        if (!edges[i].empty()) {
+            norm[i] = 0;
+            for (const auto& edge : edges[i]) {
+                norm[i] += edge.second;
+            }
+        }
+    }
+    std::vector<double> scores(size, 1.0 / static_cast<double>(size));
+    double change = std::numeric_limits<double>::max();
+    while (change > 0.001) {
+        change = 0;
+        for (size_t i = 0; i < size; i++) {
+            double score = 0;
+            for (const auto& edge : edges[i]) {
+                score += edge.second / norm[edge.first] * scores[edge.first];
+            }
+            score = 0.85 * score + 0.15;
+            change += std::abs(score - scores[i]);
+            scores[i] = score;
+        }
+    }
+    return scores;
+}
+
+bool Harness::same_scores(const Corpus& corpus, const std::string& engine, const std::vector<double>& ref_scores,
+                          const std::vector<double>& opt_scores) {
+    if (ref_scores.size() != opt_scores.size()) {
+        fail(corpus, engine + " score count differs");
+        return false;
+    }
+    for (size_t i = 0; i < ref_scores.size(); i++) {
+        double diff = std::abs(ref_scores[i] - opt_scores[i]);
+        bool both_nan = std::isnan(ref_scores[i]) && std::isnan(opt_scores[i]);
+        if (!both_nan && !(diff <= config_.tolerance * std::max(1.0, std::abs(ref_scores[i])))) {
+            fail(corpus, engine + " score of sentence " + std::to_string(i) + " differs by " + std::to_string(diff));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Harness::same_selection(const std::vector<double>& ref_scores, const strVec& ref_summary,
+                             const strVec& opt_summary) const {
+    if (ref_summary == opt_summary) {
+        return true;
+    }
+    if (ref_summary.size() != opt_summary.size() || ref_summary.empty()) {
+        return false;
+    }
+    std::vector<double> sorted = ref_scores;
+    std::sort(sorted.begin(), sorted.end(), std::greater<>());
+    double cut = sorted[ref_summary.size() - 1];
+    size_t near_cut = std::count_if(ref_scores.begin(), ref_scores.end(), [&](double s) {
+        return std::abs(s - cut) <= config_.tolerance * std::max(1.0, std::abs(cut));
+    });
+    size_t differing = 0;
+    for (const auto& sentence : opt_summary) {
+        if (std::find(ref_summary.begin(), ref_summary.end(), sentence) == ref_summary.end()) {
+            differing++;
+        }
+    }
+    return differing < near_cut;
+}
+
+void Harness::run(const Corpus& corpus) {
+    std::vector<Stage_Timing> timings;
+
+    // Tokenizer: sentences, processed sentences and RAKE phrases
+    strVec ref_sentences, opt_sentences;
+    phraseVector ref_processed, opt_processed, ref_phrases, opt_phrases;
+    double ref_ms = best_time(ref_sentences, [&]() {
+        std::istringstream in(corpus.text);
+        return Reference::TextProcess::parse_text_sentences(in, sent_end_chars);
+    });
+    double opt_ms = best_time(opt_sentences, [&]() {
+        std::istringstream in(corpus.text);
+        return TextProcess::parse_text_sentences(in, sent_end_chars);
+    });
+    ref_ms += best_time(ref_processed, [&]() {
+        return Reference::TextProcess::process_sentences(ref_sentences, stop_chars_, stop_words_);
+    });
+    opt_ms += best_time(opt_processed, [&]() {
+        return TextProcess::process_sentences(opt_sentences, stop_chars_, stop_words_);
+    });
+    ref_ms += best_time(ref_phrases, [&]() {
+        std::istringstream in(corpus.text);
+        return Reference::TextProcess::parse_text_phrases(in, stop_chars_, stop_words_);
+    });
+    opt_ms += best_time(opt_phrases, [&]() {
+        std::istringstream in(corpus.text);
+        return TextProcess::parse_text_phrases(in, stop_chars_, stop_words_);
+    });
+    timings.push_back({"tokenize", ref_ms, opt_ms});
+    if (ref_sentences != opt_sentences) {
+        fail(corpus, "sentences differ");
+    }
+    if (ref_processed != opt_processed) {
+        fail(corpus, "processed sentences differ");
+    }
+    if (ref_phrases != opt_phrases) {
+        fail(corpus, "phrases differ");
+    }
+
+    if (config_.max_sentences != 0 && ref_sentences.size() > config_.max_sentences) {
+        report(corpus, ref_sentences.size(), timings, " engines skipped (max-sentences)");
+        return;
+    }
+
+    // RAKE: the complete phrase order has to match
+    // The reference indexes past its deduplicated phrases when asked for more than the unique ones
+    int num_unique = static_cast<int>(std::set<strVec>(ref_phrases.begin(), ref_phrases.end()).size());
+    phraseVector ref_key_phrases, opt_key_phrases;
+    ref_ms = best_time(ref_key_phrases, [&]() {
+        Reference::RAKE rk(ref_phrases);
+        return rk.get_key_phrases(num_unique);
+    });
+    // the path of the command line: the phrases moved in, threads set, output through the lazy view
+    opt_ms = best_time(opt_key_phrases, [&]() {
+        RAKE rk{phraseVector(opt_phrases)};
+        rk.set_threads(config_.threads);
+        auto view = rk.key_phrases_view(num_unique);
+        return phraseVector(view.begin(), view.end());
+    });
+    timings.push_back({"rake", ref_ms, opt_ms});
+    if (ref_key_phrases != opt_key_phrases) {
+        fail(corpus, "RAKE phrase order differs");
+    }
+
+    // RAKE from snapshots (--snapshot, --merge-snapshots): two shards written, read back and merged
+    {
+        size_t half = opt_phrases.size() / 2;
+        Rake_Snapshot merged;
+        for (const auto& shard : {phraseVector(opt_phrases.begin(), opt_phrases.begin() + half),
+                                  phraseVector(opt_phrases.begin() + half, opt_phrases.end())}) {
+            std::stringstream stream;
+            Rake_Snapshot(shard).serialize(stream);
+            merged.merge(Rake_Snapshot::deserialize(stream));
+        }
+        RAKE rk(merged);
+        rk.set_threads(config_.threads);
+        auto view = rk.key_phrases_view(num_unique);
+        if (phraseVector(view.begin(), view.end()) != ref_key_phrases) {
+            fail(corpus, "RAKE phrase order from merged snapshots differs");
+        }
+    }
+
+    // TextRank: graph construction and ranking are timed separately
+    double ref_graph_ms = std::numeric_limits<double>::max(), opt_graph_ms = ref_graph_ms;
+    double ref_rank_ms = ref_graph_ms, opt_rank_ms = ref_graph_ms;
+    std::vector<double> ref_scores, opt_scores;
+    std::vector<strVec> ref_summaries, opt_summaries;
+    size_t num = ref_sentences.size();
+    std::vector<int> lengths = {1, 3, static_cast<int>(num / 10)};
+    for (size_t r = 0; r < config_.repeat; r++) {
+        std::optional<Reference::TextRank> ref_tk;
+        std::optional<TextRank<Similarity::Compat>> opt_tk;
+
+        auto start = std::chrono::steady_clock::now();
+        ref_tk.emplace(ref_sentences, ref_processed);
+        auto mid = std::chrono::steady_clock::now();
+        ref_scores = ref_tk->get_scores();
+        auto end = std::chrono::steady_clock::now();
+        ref_graph_ms = std::min(ref_graph_ms, std::chrono::duration<double, std::milli>(mid - start).count());
+        ref_rank_ms = std::min(ref_rank_ms, std::chrono::duration<double, std::milli>(end - mid).count());
+
+        start = std::chrono::steady_clock::now();
+        opt_tk.emplace(opt_sentences, opt_processed);
+        opt_tk->set_threads(config_.threads);
+        mid = std::chrono::steady_clock::now();
+        opt_scores = opt_tk->get_scores();
+        end = std::chrono::steady_clock::now();
+        opt_graph_ms = std::min(opt_graph_ms, std::chrono::duration<double, std::milli>(mid - start).count());
+        opt_rank_ms = std::min(opt_rank_ms, std::chrono::duration<double, std::milli>(end - mid).count());
+
+        ref_summaries.clear();
+        opt_summaries.clear();
+        for (int len : lengths) {
+            len = std::min(len, static_cast<int>(num));
+            ref_summaries.push_back(ref_tk->get_summary(len));
+            opt_summaries.push_back(opt_tk->get_summary(len));
+        }
+    }
+    timings.push_back({"textrank-graph", ref_graph_ms, opt_graph_ms});
+    timings.push_back({"textrank-rank", ref_rank_ms, opt_rank_ms});
+
+    same_scores(corpus, "TextRank", ref_scores, opt_scores);
+    for (size_t l = 0; l < lengths.size(); l++) {
+        if (!same_selection(ref_scores, ref_summaries[l], opt_summaries[l])) {
+            fail(corpus, "TextRank summary of length " + std::to_string(ref_summaries[l].size()) + " differs");
+        }
+    }
+
+    // The default overlap similarity has no reference copy, it is checked against the formula written out
+    std::vector<double> oracle_scores = overlap_oracle_scores(opt_processed);
+    TextRank<Similarity::Overlap> overlap_tk(opt_sentences, opt_processed);
+    overlap_tk.set_threads(config_.threads);
+    if (same_scores(corpus, "TextRank overlap", oracle_scores, overlap_tk.get_scores())) {
+        for (int len : lengths) {
+            len = std::min(len, static_cast<int>(num));
+            std::vector<size_t> order(num);
+            for (size_t i = 0; i < num; i++) {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return oracle_scores[a] > oracle_scores[b];
+            });
+            order.resize(len);
+            std::sort(order.begin(), order.end());  // summaries keep the order of the text
+            strVec oracle_summary;
+            for (size_t i : order) {
+                oracle_summary.push_back(opt_sentences[i]);
+            }
+            if (!same_selection(oracle_scores, oracle_summary, overlap_tk.get_summary(len))) {
+                fail(corpus, "TextRank overlap summary of length " + std::to_string(len) + " differs");
+            }
+        }
+    }
+
+    check_lazy<TextRank<Similarity::Overlap>>(corpus, "overlap", opt_sentences, opt_processed, lengths);
+    check_lazy<TextRank<Similarity::Cosine>>(corpus, "cosine", opt_sentences, opt_processed, lengths);
+    check_single_section(corpus, opt_sentences, opt_processed, lengths);
+    check_pipelined<TextRank<Similarity::Overlap>>(corpus, "overlap", opt_sentences, opt_processed);
+    check_pipelined<TextRank<Similarity::BM25>>(corpus, "bm25", opt_sentences, opt_processed);
+
+    report(corpus, num, timings);
+    check_plans(corpus, opt_sentences, opt_processed);
+}
+
+template <typename TextRank_Type>
+void Harness::check_pipelined(const Corpus& corpus, const std::string& engine, const strVec& sentences,
+                              const phraseVector& processed) {
+    TextRank_Type batch(sentences, processed);
+    batch.set_threads(config_.threads);
+    std::vector<double> batch_scores = batch.get_scores();
+    for (size_t capacity : {static_cast<size_t>(1), Pipeline::QUEUE_CAPACITY}) {
+        TextRank_Type pipelined;
+        std::istringstream in(corpus.text);
+        Pipeline::feed_sentences(in, sent_end_chars, stop_chars_, stop_words_, pipelined, capacity);
+        pipelined.set_threads(config_.threads);
+        same_scores(corpus, "TextRank " + engine + " pipelined (capacity " + std::to_string(capacity) + ")",
+                    batch_scores, pipelined.get_scores());
+    }
+}
+
+template <typename TextRank_Type>
+void Harness::check_lazy(const Corpus& corpus, const std::string& engine, const strVec& sentences,
+                         const phraseVector& processed, const std::vector<int>& lengths) {
+    // full convergence with the Jacobi update which lazy convergence uses on any number of threads
+    TextRank_Type full(sentences, processed);
+    full.set_threads(std::max<size_t>(2, config_.threads));
+    std::vector<double> full_scores = full.get_scores();
+    for (int len : lengths) {
+        len = std::min(len, static_cast<int>(sentences.size()));
+        TextRank_Type lazy(sentences, processed);
+        lazy.set_threads(config_.threads);
+        lazy.set_lazy_convergence(true);
+        if (!same_selection(full_scores, full.get_summary(len), lazy.get_summary(len))) {
+            fail(corpus, "TextRank " + engine + " lazy summary of length " + std::to_string(len) + " differs");
+        }
+    }
+}
+
+void Harness::check_single_section(const Corpus& corpus, const strVec& sentences, const phraseVector& processed,
+                                   const std::vector<int>& lengths) {
+    std::vector<double> weights;
+    for (size_t i = 0; i < sentences.size(); i++) {
+        weights.push_back(1 + static_cast<double>(i % 3));
+    }
+    for (bool weighted : {false, true}) {
+        for (bool lazy : {false, true}) {
+            for (int len : lengths) {
+                len = std::min(len, static_cast<int>(sentences.size()));
+                TextRank<> plain(sentences, processed);
+                Hierarchical_TextRank<> hierarchical(sentences, processed, {0});
+                if (weighted) {
+                    plain.set_node_weights(weights);
+                    hierarchical.set_node_weights(weights);
+                }
+                plain.set_lazy_convergence(lazy);
+                hierarchical.set_lazy_convergence(lazy);
+                hierarchical.set_threads(config_.threads);
+                if (hierarchical.get_summary(len) != plain.get_summary(len)) {
+                    fail(corpus, std::string("hierarchical TextRank of one section") + (weighted ? " with weights" : "")
+                                 + (lazy ? " with lazy convergence" : "") + " differs at length " + std::to_string(len));
+                }
+            }
+        }
+    }
+}
+
+void Harness::check_pipeline_errors(const Corpus& fixed) {
+    struct Throwing_Ranker {
+        size_t added = 0;
+
+        void add_sentence(std::string&&, strVec&&) {
+            if (++added == 50) {
+                throw std::runtime_error("ranker failed");
+            }
+        }
+    };
+    std::string text;
+    for (size_t i = 0; i < 2000; i++) {
+        text += "Sentence number " + std::to_string(i) + " of the pipeline test. ";
+    }
+    for (size_t capacity : {1, 4, 1024}) {
+        Throwing_Ranker ranker;
+        std::istringstream in(text);
+        try {
+            Pipeline::feed_sentences(in, sent_end_chars, stop_chars_, stop_words_, ranker, capacity);
+            fail(fixed, "pipeline swallowed the exception of the ranker");
+        }
+        catch (const std::runtime_error& e) {
+            if (std::string(e.what()) != "ranker failed" || ranker.added != 50) {
+                fail(fixed, "pipeline did not stop at the exception of the ranker");
+            }
+        }
+    }
+}
+
+void Harness::check_plans(const Corpus& corpus, const strVec& sentences, const phraseVector& processed) {
+    size_t len = sentences.size() / 3;
+    std::vector<Planner::Plan> plans = Planner::candidate_plans(Planner::measure(processed), config_.threads, len);
+    std::vector<bool> seen(Planner::APPROXIMATE + 1, false);
+    for (const auto& plan : plans) {
+        if (seen[plan.strategy]) {
+            continue;
+        }
+        seen[plan.strategy] = true;
+        strVec summary;
+        double measured_ms = best_time(summary, [&]() {
+            if (plan.strategy == Planner::HIERARCHICAL) {
+                std::vector<size_t> section_starts;
+                for (size_t start = 0; start < sentences.size(); start += plan.section_size) {
+                    section_starts.push_back(start);
+                }
+                Hierarchical_TextRank<> tk(sentences, processed, section_starts);
+                tk.set_threads(config_.threads);
+                return tk.get_summary(static_cast<int>(len));
+            }
+            TextRank<> tk(sentences, processed, plan.limits);
+            tk.set_threads(config_.threads);
+            return tk.get_summary(static_cast<int>(len));
+        });
+        std::cout << "  plan " << Planner::describe(plan) << ", took " << std::fixed << std::setprecision(3)
+                  << measured_ms << " ms" << std::endl;
+        if (measured_ms >= config_.min_time_ms && measured_ms > plan.time_ms * config_.max_misestimate) {
+            fail(corpus, "plan " + Planner::describe(plan) + " took " + std::to_string(measured_ms) + " ms");
+        }
+    }
+}
+
+void Harness::run_fixed_cases() {
+    const Corpus fixed = {"fixed cases", ""};
+    check_throwing_blocks(fixed);
+    check_malformed_snapshots(fixed);
+    check_streaming_counts(fixed);
+    check_deduplication(fixed);
+    check_adjoined_phrases(fixed);
+    check_pipeline_errors(fixed);
+    check_similarity_policies(fixed);
+}
+
+void Harness::check_throwing_blocks(const Corpus& fixed) {
+    const size_t num_blocks = 64;
+    auto throwing = [](size_t b) {
+        if (b == 5) {
+            throw std::runtime_error("block 5");
+        }
+    };
+    auto expect_rethrow = [&](const std::string& what, auto&& run) {
+        try {
+            run();
+            fail(fixed, what + " swallowed the exception of a block");
+        }
+        catch (const std::runtime_error& e) {
+            if (std::string(e.what()) != "block 5") {
+                fail(fixed, what + " rethrew " + e.what());
+            }
+        }
+    };
+    expect_rethrow("for_each_block", [&]() { Parallel::for_each_block(num_blocks, 4, throwing); });
+
+    Parallel::Thread_Team team(4);
+    expect_rethrow("Thread_Team", [&]() { team.for_each_block(num_blocks, throwing); });
+    std::vector<size_t> done(num_blocks, 0);
+    team.for_each_block(num_blocks, [&](size_t b) { done[b]++; });
+    if (std::count(done.begin(), done.end(), 1) != static_cast<long>(num_blocks)) {
+        fail(fixed, "Thread_Team did not run every block once after an exception");
+    }
+}
+
+void Harness::check_streaming_counts(const Corpus& fixed) {
+    // every other key is one of 3 frequent keys, the rest are distinct and churn the 16 monitored entries,
+    // Space-Saving keeps every key seen more than 3000 / 16 times
+    const size_t capacity = 16;
+    Space_Saving phrases(capacity);
+    Count_Min_Sketch sketch(64, 4);
+    std::map<std::string, double> truth;
+    for (size_t i = 0; i < 3000; i++) {
+        std::string key = (i % 2 == 0) ? "frequent " + std::to_string(i / 2 % 3) : "rare " + std::to_string(i);
+        phrases.add(key);
+        sketch.add(key, 1, 2);
+        truth[key]++;
+    }
+    if (phrases.entries().size() != capacity) {
+        fail(fixed, "Space-Saving monitors " + std::to_string(phrases.entries().size()) + " phrases");
+    }
+    size_t frequent = 0;
+    for (const auto& entry : phrases.entries()) {
+        double count = truth[entry.key];
+        frequent += entry.key.starts_with("frequent");
+        if (entry.count - entry.error > count || entry.count < count) {
+            fail(fixed, "Space-Saving count of " + entry.key + " does not bound " + std::to_string(count));
+        }
+    }
+    if (frequent != 3) {
+        fail(fixed, "Space-Saving evicted a frequent phrase");
+    }
+    for (const auto& [key, count] : truth) {
+        Count_Min_Sketch::Counts estimate = sketch.estimate(key);
+        if (estimate.freq < count || estimate.deg < 2 * count) {
+            fail(fixed, "count-min estimate of " + key + " is below its count");
+            break;
+        }
+    }
+
+    // the same through Streaming_RAKE, the phrase repeated in every sentence leads the key phrases
+    // the parser keeps references to the stop sets
+    const std::unordered_set<char> stop_chars = {'.', ','};
+    const std::unordered_set<std::string> stop_words = {"the", "of", "and"};
+    Streaming_RAKE rk(stop_chars, stop_words, 8, 256);
+    std::string text;
+    for (size_t i = 0; i < 200; i++) {
+        text += "red planet canal and the filler" + std::to_string(i) + " word" + std::to_string(i) + ". ";
+    }
+    for (char c : text) {
+        rk.feed(c);
+    }
+    rk.finish();
+    phraseVector key_phrases = rk.get_key_phrases(1);
+    if (key_phrases.empty() || key_phrases.front() != strVec{"red", "planet", "canal"}) {
+        fail(fixed, "streaming RAKE lost the phrase repeated in every sentence");
+    }
+}
+
+void Harness::check_deduplication(const Corpus& fixed) {
+    auto words = [](const std::string& prefix, size_t count) {
+        strVec tokens;
+        for (size_t i = 0; i < count; i++) {
+            tokens.push_back(prefix + std::to_string(i));
+        }
+        return tokens;
+    };
+    strVec base = words("base", 41);
+    strVec other = words("other", 41);
+    // a sentence with one more word whose hash lands within the distance of the base sentence
+    strVec near;
+    for (size_t k = 0; k < 10000 && near.empty(); k++) {
+        strVec candidate = base;
+        candidate.push_back("extra" + std::to_string(k));
+        unsigned distance = Deduplication::hamming_distance(Deduplication::simhash(base),
+                                                            Deduplication::simhash(candidate));
+        if (distance > 0 && distance <= Deduplication::MAX_DISTANCE) {
+            near = candidate;
+        }
+    }
+    if (near.empty() || Deduplication::hamming_distance(Deduplication::simhash(base), Deduplication::simhash(other))
+                        <= Deduplication::MAX_DISTANCE) {
+        fail(fixed, "no near duplicate to test deduplication with");
+        return;
+    }
+    strVec reversed(base.rbegin(), base.rend());
+    strVec sentences = {"base", "other", "stop words", "base again", "base near", "stop words"};
+    phraseVector tokenized = {base, other, {}, reversed, near, {}};
+
+    auto text = Deduplication::collapse_near_duplicates(strVec(sentences), phraseVector(tokenized));
+    if (text.sentences != strVec{"base", "other", "stop words", "stop words"} ||
+        text.copies != std::vector<size_t>{3, 1, 1, 1} ||
+        text.tokenized_sentences != phraseVector{base, other, {}, {}}) {
+        fail(fixed, "near duplicates were not collapsed into their first sentence");
+    }
+    std::vector<double> weights = Deduplication::node_weights(text.copies);
+    if (weights.size() != 4 || std::abs(weights[0] - (1 + std::log(3.0))) > 1e-12 || weights[1] != 1) {
+        fail(fixed, "weights of collapsed sentences are not 1 + ln(copies)");
+    }
+    // distance 0 keeps the near duplicate apart, it only collapses sentences with the same words
+    auto exact = Deduplication::collapse_near_duplicates(strVec(sentences), phraseVector(tokenized), 0);
+    if (exact.copies != std::vector<size_t>{2, 1, 1, 1, 1}) {
+        fail(fixed, "deduplication at distance 0 collapsed different sentences");
+    }
+}
+
+void Harness::check_adjoined_phrases(const Corpus& fixed) {
+    // phrases: 3 times axis and evil, evil doers and world, "axis of evil" is adjoined 3 times
+    // scores: evil doers 3.25, axis of evil 2.25 (axis 1 + evil 1.25), evil 1.25, axis 1, world 1
+    const std::unordered_set<char> stop_chars = {'.'};
+    const std::unordered_set<std::string> stop_words = {"the", "of", "was"};
+    const std::string text = "The axis of evil. The axis of evil. Axis of evil. Evil doers of the world.";
+    std::vector< std::pair<strVec, size_t> > adjoined;
+    std::istringstream in(text);
+    Rake_Snapshot snapshot(TextProcess::parse_text_phrases_adjoined(in, stop_chars, stop_words, adjoined));
+    snapshot.add_adjoined(adjoined);
+
+    const phraseVector expected = {{"evil", "doers"}, {"axis", "of", "evil"}, {"evil"}, {"axis"}, {"world"}};
+    RAKE with_adjoined(snapshot, 3);
+    if (with_adjoined.get_key_phrases(5) != expected) {
+        fail(fixed, "RAKE with adjoined phrases seen 3 times ranks differently");
+    }
+    // the adjoined candidate counts as one more phrase, 9 instead of 8
+    if (RAKE(snapshot, 3).get_key_phrases(0.24).size() != 2 || RAKE(snapshot, 4).get_key_phrases(0.24).size() != 1) {
+        fail(fixed, "adjoined candidates are not counted as phrases");
+    }
+    phraseVector without = expected;
+    without.erase(without.begin() + 1);
+    if (RAKE(snapshot, 4).get_key_phrases(4) != without || RAKE(snapshot).get_key_phrases(4) != without) {
+        fail(fixed, "RAKE kept an adjoined phrase below its minimum count");
+    }
+
+    std::stringstream first, second;
+    snapshot.serialize(first);
+    if (first.str().rfind("RAKE_SNAPSHOT 2", 0) != 0) {
+        fail(fixed, "snapshot with adjoined phrases is not written as version 2");
+    }
+    Rake_Snapshot read = Rake_Snapshot::deserialize(first);
+    read.serialize(second);
+    if (second.str() != first.str() || RAKE(read, 3).get_key_phrases(5) != expected) {
+        fail(fixed, "version 2 snapshot changed through serialize and deserialize");
+    }
+}
+
+void Harness::check_similarity_policies(const Corpus& fixed) {
+    // sentence 0: a b c, 1: a a d, 2: b e; a and b are in 2 of the 3 sentences, c, d and e in 1
+    Similarity::Corpus corpus;
+    for (const strVec& sentence : phraseVector{{"a", "b", "c"}, {"a", "a", "d"}, {"b", "e"}}) {
+        corpus.add_sentence(sentence);
+    }
+    auto similarity = [&]<typename Policy>(std::type_identity<Policy>, size_t i, size_t j) {
+        Policy policy(corpus);
+        Similarity::Row_Probe probe;
+        probe.load(corpus, i);
+        double value = policy(probe, corpus, j);
+        probe.unload();
+        return value;
+    };
+    auto expect = [&](const std::string& what, double value, double expected) {
+        if (!(std::abs(value - expected) <= 1e-12 * std::max(1.0, std::abs(expected)))) {
+            fail(fixed, what + " similarity is " + std::to_string(value) + " instead of " + std::to_string(expected));
+        }
+    };
+    const double ln2 = std::log(2.0), ln3 = std::log(3.0);
+
+    // distinct shared words / (ln|S1| + ln|S2|)
+    expect("overlap(0, 1)", similarity(std::type_identity<Similarity::Overlap>{}, 0, 1), 1 / (2 * ln3));
+    expect("overlap(1, 0)", similarity(std::type_identity<Similarity::Overlap>{}, 1, 0), 1 / (2 * ln3));
+    expect("overlap(0, 2)", similarity(std::type_identity<Similarity::Overlap>{}, 0, 2), 1 / (ln3 + ln2));
+    expect("overlap(1, 2)", similarity(std::type_identity<Similarity::Overlap>{}, 1, 2), 0);
+    // compat counts the shared words of the first sentence with their repetitions
+    expect("compat(0, 1)", similarity(std::type_identity<Similarity::Compat>{}, 0, 1), 1 / (2 * ln3));
+    expect("compat(1, 0)", similarity(std::type_identity<Similarity::Compat>{}, 1, 0), 2 / (2 * ln3));
+    // cosine of TF-IDF vectors, idf = ln((1 + N) / (1 + df)) + 1
+    double idf_common = std::log(4.0 / 3) + 1, idf_rare = std::log(2.0) + 1;
+    double norm0 = std::sqrt(2 * idf_common * idf_common + idf_rare * idf_rare);
+    double norm1 = std::sqrt(4 * idf_common * idf_common + idf_rare * idf_rare);
+    double norm2 = std::sqrt(idf_common * idf_common + idf_rare * idf_rare);
+    expect("cosine(0, 1)", similarity(std::type_identity<Similarity::Cosine>{}, 0, 1),
+           2 * idf_common * idf_common / (norm0 * norm1));
+    expect("cosine(0, 2)", similarity(std::type_identity<Similarity::Cosine>{}, 0, 2),
+           idf_common * idf_common / (norm0 * norm2));
+    expect("cosine(1, 2)", similarity(std::type_identity<Similarity::Cosine>{}, 1, 2), 0);
+    // BM25 of both directions averaged, idf = ln((N - df + 0.5) / (df + 0.5) + 1),
+    // length norm K1 * (1 - B + B * |S| / (8 / 3)) with K1 = 1.2 and B = 0.75
+    double idf_bm25 = std::log(1.6);
+    double length3 = 1.2 * (0.25 + 0.75 * 9.0 / 8), length2 = 1.2 * (0.25 + 0.75 * 6.0 / 8);
+    expect("bm25(0, 1)", similarity(std::type_identity<Similarity::BM25>{}, 0, 1),
+           idf_bm25 * (2 * 2.2 / (2 + length3) + 2.2 / (1 + length3)) / 2);
+    expect("bm25(0, 2)", similarity(std::type_identity<Similarity::BM25>{}, 0, 2),
+           idf_bm25 * (2.2 / (1 + length2) + 2.2 / (1 + length3)) / 2);
+    expect("bm25(1, 2)", similarity(std::type_identity<Similarity::BM25>{}, 1, 2), 0);
+
+    // rankings recorded from the sequential iteration, each policy orders the text differently
+    check_golden_ranking<Similarity::Overlap>(fixed, "overlap", {0, 1, 4, 2, 3},
+                                              {1.304510567, 1.17638568, 0.7968216233, 0.7075553634, 1.012206595});
+    check_golden_ranking<Similarity::Compat>(fixed, "compat", {1, 0, 4, 3, 2},
+                                             {1.200637577, 1.267085303, 0.7450553679, 0.8544229546, 0.9302960642});
+    check_golden_ranking<Similarity::Cosine>(fixed, "cosine", {1, 0, 3, 4, 2},
+                                             {1.232318102, 1.249283378, 0.7690740374, 0.9281686296, 0.8186771746});
+    check_golden_ranking<Similarity::BM25>(fixed, "bm25", {1, 0, 4, 3, 2},
+                                           {1.227013467, 1.233412621, 0.8169936144, 0.8443984472, 0.8756839502});
+}
+
+template <typename SimilarityPolicy>
+void Harness::check_golden_ranking(const Corpus& fixed, const std::string& engine, const std::vector<size_t>& ranking,
+                                   const std::vector<double>& scores) {
+    const phraseVector tokenized = {{"mars", "red", "planet"}, {"mars", "canal", "water", "water"},
+                                    {"red", "dust", "storm", "planet"}, {"water", "canal"},
+                                    {"planet", "orbit", "sun", "mars"}};
+    const strVec sentences = {"0", "1", "2", "3", "4"};
+    TextRank<SimilarityPolicy> tk(sentences, tokenized);
+    if (tk.get_ranking(sentences.size()) != ranking) {
+        fail(fixed, "TextRank " + engine + " ranking differs from the recorded one");
+    }
+    std::vector<double> actual = tk.get_scores();
+    for (size_t i = 0; i < scores.size(); i++) {
+        if (!(std::abs(actual[i] - scores[i]) <= 1e-8)) {
+            fail(fixed, "TextRank " + engine + " score of sentence " + std::to_string(i) + " differs from the recorded one");
+            return;
+        }
+    }
+}
+
+void Harness::check_malformed_snapshots(const Corpus& fixed) {
+    const std::vector<std::string> snapshots = {
+            "RAKE_SNAPSHOT 2\nphrases 1\nwords 0\nunique 1\n1 18446744073709551615 axis evil\n",
+            "RAKE_SNAPSHOT 2\nphrases 1\nwords 1\naxis 1 1\nunique 1\n1 1 axis\n",
+            "RAKE_SNAPSHOT 3\nphrases 0\nwords 0\nunique 0\nadjoined 0\n"};
+    for (const auto& text : snapshots) {
+        std::istringstream in(text);
+        try {
+            Rake_Snapshot::deserialize(in);
+            fail(fixed, "malformed snapshot was read: " + text.substr(0, text.find('\n', 16)));
+        }
+        catch (const std::runtime_error&) {
+        }
+        catch (const std::exception& e) {
+            fail(fixed, std::string("malformed snapshot threw ") + e.what() + " instead of std::runtime_error");
+        }
+    }
+}
+
+void Harness::report(const Corpus& corpus, size_t num_sentences, const std::vector<Stage_Timing>& timings,
+                     const std::string& note) {
+    std::cout << corpus.name << " (" << num_sentences << " sentences)" << note << std::endl;
+    for (const auto& timing : timings) {
+        double speedup = timing.reference_ms / std::max(timing.optimized_ms, 1e-9);
+        std::cout << "  " << std::left << std::setw(16) << timing.stage << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << timing.reference_ms << " ms"
+                  << std::setw(12) << timing.optimized_ms << " ms"
+                  << std::setw(10) << std::setprecision(2) << speedup << "x" << std::endl;
+
+        bool measurable = std::max(timing.reference_ms, timing.optimized_ms) >= config_.min_time_ms;
+        if (measurable && timing.optimized_ms > timing.reference_ms * config_.max_slowdown) {
+            fail(corpus, "stage " + timing.stage + " regressed, speedup " + std::to_string(speedup));
+        }
+    }
+}
+
+// Generates a random text over a Zipf distributed vocabulary, mixed with stop words and punctuation
+std::string generate_corpus(size_t num_sentences, std::mt19937& rng, const std::unordered_set<std::string>& stop_words) {
+    const size_t vocab_size = 5000;
+    std::vector<std::string> vocabulary;
+    vocabulary.reserve(vocab_size);
+    for (size_t i = 0; i < vocab_size; i++) {
+        std::string word;
+        for (size_t x = i + 1; x > 0; x /= 26) {
+            word += static_cast<char>('a' + x % 26);
+        }
+        vocabulary.push_back(word + "x");   // suffix keeps the generated words apart from real stop words
+    }
+    std::vector<std::string> stops(stop_words.begin(), stop_words.end());
+    std::sort(stops.begin(), stops.end());  // unordered_set iteration order is not portable
+
+    std::vector<double> weights(vocab_size);
+    for (size_t i = 0; i < vocab_size; i++) {
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    std::uniform_int_distribution<size_t> sentence_len(3, 25);
+    std::uniform_int_distribution<size_t> stop_pick(0, stops.size() - 1);
+    std::uniform_real_distribution<double> coin(0, 1);
+    const std::string enders = ".!?";
+
+    std::string text;
+    size_t words_on_line = 0;
+    for (size_t s = 0; s < num_sentences; s++) {
+        size_t len = sentence_len(rng);
+        for (size_t w = 0; w < len; w++) {
+            double c = coin(rng);
+            if (c < 0.3 && !stops.empty()) {
+                text += stops[stop_pick(rng)];
+            }
+            else {
+                text += vocabulary[zipf(rng)];
+            }
+            if (c > 0.95 && w + 1 < len) {
+                text += ',';
+            }
+            text += (++words_on_line % 12 == 0) ? '\n' : ' ';
+        }
+        text.back() = enders[s % enders.size()];
+        text += ' ';
+    }
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    Harness_Config config;
+
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+            ("help", "produce help message")
+            ("inputs", boost::program_options::value<std::string>(&config.inputs_dir), "directory with the .txt corpora (default inputs)")
+            ("generated", boost::program_options::value<size_t>(&config.generated), "number of generated corpora (default 3)")
+            ("generated-sentences", boost::program_options::value<size_t>(&config.generated_sentences), "sentences in the smallest generated corpus, doubled for each next one (default 2000)")
+            ("seed", boost::program_options::value<unsigned int>(&config.seed), "seed of the corpus generator (default 42)")
+            ("repeat", boost::program_options::value<size_t>(&config.repeat), "timing repetitions, the best one is reported (default 3)")
+            ("threads", boost::program_options::value<size_t>(&config.threads), "threads used by the optimized engines (default 1)")
+            ("max-sentences", boost::program_options::value<size_t>(&config.max_sentences), "skip the engines on corpora with more sentences (default no limit)")
+            ("max-slowdown", boost::program_options::value<double>(&config.max_slowdown), "fail if a stage is slower than this multiple of the reference (default 1.25)")
+            ("min-time-ms", boost::program_options::value<double>(&config.min_time_ms), "stages faster than this are not judged for regressions (default 2)")
+            ("tolerance", boost::program_options::value<double>(&config.tolerance), "relative tolerance of TextRank scores (default 1e-6)")
+            ("max-misestimate", boost::program_options::value<double>(&config.max_misestimate), "fail if a plan of the planner takes longer than this multiple of its estimate (default 4)");
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+    boost::program_options::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    if (config.repeat == 0 || config.threads == 0) {
+        std::cerr << "Error: <repeat> and <threads> must be positive!" << std::endl;
+        return 2;
+    }
+
+    auto stop_chars = TextProcess::load_stop_chars(STOP_CHARS_PATH);
+    auto stop_words = TextProcess::load_stop_words(STOP_WORDS_PATH);
+
+    std::vector<Corpus> corpora;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(config.inputs_dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& path : files) {
+        std::ifstream file = FileProcess::open_file<std::ifstream>(path.string(), std::ios_base::in);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        corpora.push_back({path.filename().string(), buffer.str()});
+    }
+    std::mt19937 rng(config.seed);
+    for (size_t g = 0; g < config.generated; g++) {
+        size_t num_sentences = config.generated_sentences << g;
+        corpora.push_back({"generated-" + std::to_string(num_sentences), generate_corpus(num_sentences, rng, stop_words)});
+    }
+
+    Harness harness(config, stop_chars, stop_words);
+    std::cout << "stage                  reference       optimized    speedup" << std::endl;
+    harness.run_fixed_cases();
+    for (const auto& corpus : corpora) {
+        harness.run(corpus);
+    }
+
+    if (!harness.failures().empty()) {
+        std::cout << std::endl << "FAILED:" << std::endl;
+        for (const auto& failure : harness.failures()) {
+            std::cout << "  " << failure << std::endl;
+        }
+        return 1;
+    }
+    std::cout << std::endl << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,169 @@
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef UNORDERED_MAP
+#define UNORDERED_MAP
+#include <unordered_map>
+#endif
+
+#ifndef UNORDERED_SET
+#define UNORDERED_SET
+#include <unordered_set>
+#endif
+
+#ifndef FUNCTIONAL
+#define FUNCTIONAL
+#include <functional>
+#endif
+
+#ifndef BIT
+#define BIT
+#include <bit>
+#endif
+
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+#ifndef STDEXCEPT
+#define STDEXCEPT
+#include <stdexcept>
+#endif
+
+#include "Deduplication.hpp"
+#include "Trace.hpp"
+
+namespace Deduplication {
+    namespace {
+        // splitmix64 finalizer, std::hash of a string is not guaranteed to spread over all 64 bits
+        uint64_t mix(uint64_t h) {
+            h += 0x9e3779b97f4a7c15ULL;
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+            return h ^ (h >> 31);
+        }
+
+        constexpr unsigned BAND_BITS = 64 / BANDS;
+
+        // Bucket key of band b of a hash, the band number is kept in the top bits
+        uint64_t band_key(uint64_t hash, unsigned b) {
+            uint64_t band = (hash >> (b * BAND_BITS)) & ((static_cast<uint64_t>(1) << BAND_BITS) - 1);
+            return (static_cast<uint64_t>(b) << BAND_BITS) | band;
+        }
+    }
+
+    // SimHash of the distinct tokens of a sentence, every token votes once for each bit of its hash
+    uint64_t simhash(const strVec& tokenized_sentence) {
+        std::unordered_set<std::string> tokens(tokenized_sentence.begin(), tokenized_sentence.end());
+        int votes[64] = {};
+        for (const auto& token : tokens) {
+            uint64_t h = mix(std::hash<std::string>{}(token));
+            for (unsigned bit = 0; bit < 64; bit++) {
+                votes[bit] += ((h >> bit) & 1) ? 1 : -1;
+            }
+        }
+        uint64_t hash = 0;
+        for (unsigned bit = 0; bit < 64; bit++) {
+            if (votes[bit] > 0) {
+                hash |= static_cast<uint64_t>(1) << bit;
+            }
+        }
+        return hash;
+    }
+
+    // Number of bits in which two hashes differ
+    unsigned hamming_distance(uint64_t a, uint64_t b) {
+        return static_cast<unsigned>(std::popcount(a ^ b));
+    }
+
+    // Returns for every sentence the index of the first sentence of its group of near duplicates
+    // Sentences without tokens are never grouped, the others join the group of the earliest representative
+    // within max_distance (at most MAX_DISTANCE), found through buckets of equal bands so the cost stays close to linear
+    std::vector<size_t> group_near_duplicates(const phraseVector& tokenized_sentences, unsigned max_distance) {
+        TRACE_SCOPE("group_near_duplicates");
+        if (max_distance > MAX_DISTANCE) {
+            throw std::runtime_error("Error: Near duplicates can differ in at most " + std::to_string(MAX_DISTANCE) + " bits!");
+        }
+        std::vector<size_t> group(tokenized_sentences.size());
+        std::vector<uint64_t> hashes(tokenized_sentences.size());
+        std::unordered_map<uint64_t, size_t> exact;                     // hash -> representative of its group
+        std::unordered_map<uint64_t, std::vector<size_t> > buckets;     // band key -> representatives, increasing
+
+        for (size_t i = 0; i < tokenized_sentences.size(); i++) {
+            group[i] = i;
+            if (tokenized_sentences[i].empty()) {   // nothing to compare, sentences of stop words stay apart
+                continue;
+            }
+            uint64_t hash = simhash(tokenized_sentences[i]);
+            hashes[i] = hash;
+            auto same = exact.find(hash);
+            if (same != exact.end()) {
+                group[i] = same->second;
+                continue;
+            }
+
+            bool near = max_distance > 0 && std::unordered_set<std::string>(tokenized_sentences[i].begin(),
+                                                                            tokenized_sentences[i].end()).size() >= MIN_NEAR_TOKENS;
+            size_t best = i;
+            for (unsigned b = 0; b < BANDS && near; b++) {
+                auto bucket = buckets.find(band_key(hash, b));
+                if (bucket == buckets.end()) {
+                    continue;
+                }
+                for (size_t candidate : bucket->second) {
+                    if (candidate >= best) {
+                        break;
+                    }
+                    if (hamming_distance(hash, hashes[candidate]) <= max_distance) {
+                        best = candidate;
+                        break;
+                    }
+                }
+            }
+            group[i] = best;
+            exact.emplace(hash, best);
+            if (best == i && near) {    // new representative
+                for (unsigned b = 0; b < BANDS; b++) {
+                    buckets[band_key(hash, b)].push_back(i);
+                }
+            }
+        }
+        return group;
+    }
+
+    Collapsed_Text collapse_near_duplicates(strVec&& sentences, phraseVector&& tokenized_sentences, unsigned max_distance) {
+        std::vector<size_t> group = group_near_duplicates(tokenized_sentences, max_distance);
+        std::vector<size_t> collapsed_index(sentences.size());
+        Collapsed_Text text;
+        for (size_t i = 0; i < sentences.size(); i++) {
+            if (group[i] == i) {
+                collapsed_index[i] = text.sentences.size();
+                text.sentences.push_back(std::move(sentences[i]));
+                text.tokenized_sentences.push_back(std::move(tokenized_sentences[i]));
+                text.copies.push_back(1);
+            }
+            else {
+                text.copies[collapsed_index[group[i]]]++;
+            }
+        }
+        return text;
+    }
+
+    // TextRank node weights of the collapsed sentences, the share of the random jump grows with the log of the copies
+    std::vector<double> node_weights(const std::vector<size_t>& copies) {
+        std::vector<double> weights;
+        weights.reserve(copies.size());
+        for (size_t count : copies) {
+            weights.push_back(1 + std::log(static_cast<double>(count)));
+        }
+        return weights;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PROJECT_DEDUPLICATION_HPP
+#define PROJECT_DEDUPLICATION_HPP
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef CSTDINT
+#define CSTDINT
+#include <cstdint>
+#endif
+
+// Collapsing of repeated sentences (navigation, disclaimers, quotes) before TextRank
+// Sentences are compared by the SimHash of their set of tokens, two sentences are near duplicates
+// if their hashes differ in at most max_distance bits
+namespace Deduplication {
+    using strVec = std::vector<std::string>;
+    using phraseVector = std::vector< strVec >;
+
+    // The 64 bit hash is cut into this many bands, a pair within distance BANDS - 1 agrees on at least one band
+    constexpr unsigned BANDS = 4;
+    constexpr unsigned MAX_DISTANCE = BANDS - 1;
+    // Sentences with fewer distinct tokens are only collapsed with sentences of exactly the same hash,
+    // a few tokens do not flip enough bits to tell similar sentences from different ones
+    constexpr size_t MIN_NEAR_TOKENS = 4;
+
+    // SimHash of the distinct tokens of a sentence, every token votes once for each bit of its hash
+    uint64_t simhash(const strVec& tokenized_sentence);
+
+    // Number of bits in which two hashes differ
+    unsigned hamming_distance(uint64_t a, uint64_t b);
+
+    // Returns for every sentence the index of the first sentence of its group of near duplicates
+    // Sentences without tokens are never grouped, the others join the group of the earliest representative
+    // within max_distance (at most MAX_DISTANCE), found through buckets of equal bands so the cost stays close to linear
+    std::vector<size_t> group_near_duplicates(const phraseVector& tokenized_sentences, unsigned max_distance = MAX_DISTANCE);
+
+    // A text with every group of near duplicates replaced by its first sentence
+    struct Collapsed_Text {
+        strVec sentences;
+        phraseVector tokenized_sentences;
+        std::vector<size_t> copies;         // number of sentences of the original text each sentence stands for
+    };
+
+    Collapsed_Text collapse_near_duplicates(strVec&& sentences, phraseVector&& tokenized_sentences,
+                                            unsigned max_distance = MAX_DISTANCE);
+
+    // TextRank node weights of the collapsed sentences, the share of the random jump grows with the log of the copies
+    std::vector<double> node_weights(const std::vector<size_t>& copies);
+}
+
+#endif //PROJECT_DEDUPLICATION_HPP
@@ -0,0 +1,278 @@
+#ifndef PROJECT_HIERARCHICALTEXTRANK_HPP
+#define PROJECT_HIERARCHICALTEXTRANK_HPP
+
+#ifndef IOSTREAM
+#define IOSTREAM
+#include <iostream>
+#endif
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef NUMERIC
+#define NUMERIC
+#include <numeric>
+#endif
+
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+#include "TextRank.hpp"
+#include "Parallel.hpp"
+
+// Multi level TextRank for long documents
+// TextRank_Type ranks the sentences of every section on its own (sections run concurrently),
+// the best sentences of each section are then ranked again against each other. The next level is a single graph
+// if they are few enough, otherwise they are ranked in groups of consecutive sentences, level after level.
+// Once a level no longer cuts the number of sentences (a long summary) the summary is taken from its scores,
+// which are comparable between graphs since TextRank scores average about 1 in any graph.
+// No graph is larger than the largest section or MIN_GROUP_SIZE, so with sections of bounded size
+// the cost grows linearly with the length of the document, also for long summaries.
+template <typename TextRank_Type = TextRank<>>
+class Hierarchical_TextRank {
+    using strVec = std::vector<std::string>;
+    using phraseVector = std::vector< strVec >;
+
+    strVec sentences_;
+    phraseVector tokenized_sentences_;
+    std::vector<size_t> section_starts_;
+    std::vector<double> node_weights_;     // empty if every sentence has weight 1
+    size_t num_threads_ = 1;
+    bool lazy_convergence_ = false;
+
+public:
+    // Each group passes OVERSAMPLE times its share of the summary to the next level
+    static constexpr double OVERSAMPLE = 2;
+    // Levels after the first rank groups of at most max(MIN_GROUP_SIZE, largest section) sentences
+    static constexpr size_t MIN_GROUP_SIZE = 100;
+
+    // section_starts holds the index of the first sentence of every section, starting with 0
+    template <typename StrVec, typename PhraseVector>
+    Hierarchical_TextRank(StrVec&& sentences, PhraseVector&& tokenized_sentences, std::vector<size_t> section_starts)
+            : section_starts_(std::move(section_starts)) {
+        sentences_ = std::forward<StrVec>(sentences);
+        tokenized_sentences_ = std::forward<PhraseVector>(tokenized_sentences);
+        if (sentences_.size() != tokenized_sentences_.size()) {
+            throw std::runtime_error("Error: Every sentence needs its tokenized version!");
+        }
+        if (section_starts_.empty() || section_starts_.front() != 0 ||
+            !std::is_sorted(section_starts_.begin(), section_starts_.end())) {
+            throw std::runtime_error("Error: Sections must start with sentence 0 and be in order!");
+        }
+    }
+
+    // Returns summary of length calculated by percentage of the overall length of the text
+    strVec get_summary(double percent = static_cast<double>(1) / 3) {
+        if (percent < 0 || percent > 1) {
+            throw std::runtime_error("Error: Percentage of sentences included in the summary should be between 0 and 1!");
+        }
+        return get_summary_priv(static_cast<size_t>(sentences_.size() * percent));
+    }
+
+    // Returns summary with specified number of sentences
+    strVec get_summary(int len_i) {
+        if (len_i < 0) {
+            throw std::runtime_error("Error: Length of summary cannot be negative!");
+        }
+        size_t len = static_cast<size_t>(len_i);
+        if (len > sentences_.size()) {
+            std::cerr << "Warning: Length of summary requested is longer than the text." << std::endl;
+        }
+        return get_summary_priv(std::min(len, sentences_.size()));
+    }
+
+    // Sets the number of sections ranked concurrently
+    void set_threads(size_t num_threads) {
+        if (num_threads == 0) {
+            throw std::runtime_error("Error: Number of threads must be positive!");
+        }
+        num_threads_ = num_threads;
+    }
+
+    // Weights of the sentences, indexed by their position in the text, see TextRank::set_node_weights
+    // Every graph gets the weights of its own sentences
+    void set_node_weights(const std::vector<double>& weights) {
+        if (weights.size() != sentences_.size()) {
+            throw std::runtime_error("Error: Hierarchical TextRank needs one node weight per sentence!");
+        }
+        node_weights_ = weights;
+    }
+
+    // With lazy convergence a graph whose best sentences are passed on stops iterating once they are settled,
+    // a level whose scores are compared across graphs still runs until full convergence
+    void set_lazy_convergence(bool lazy) {
+        lazy_convergence_ = lazy;
+    }
+
+private:
+    // Indices of the len best scores, ties broken by position like TextRank::custom_comp
+    static std::vector<size_t> top_indices(const std::vector<double>& scores, size_t len) {
+        std::vector<size_t> order(scores.size());
+        std::iota(order.begin(), order.end(), 0);
+        len = std::min(len, order.size());
+        std::partial_sort(order.begin(), order.begin() + len, order.end(), [&](size_t a, size_t b) {
+            if (scores[a] != scores[b]) {
+                return scores[a] > scores[b];
+            }
+            return a < b;
+        });
+        order.resize(len);
+        return order;
+    }
+
+    // Ranks the sentences with the given indices on their own as a TextRank_Type, returns fn(textrank)
+    template <typename Fn>
+    auto rank(const std::vector<size_t>& indices, Fn&& fn) const {
+        strVec sentences;
+        phraseVector tokenized;
+        std::vector<double> weights;
+        sentences.reserve(indices.size());
+        tokenized.reserve(indices.size());
+        for (size_t i : indices) {
+            sentences.push_back(sentences_[i]);
+            tokenized.push_back(tokenized_sentences_[i]);
+            if (!node_weights_.empty()) {
+                weights.push_back(node_weights_[i]);
+            }
+        }
+        TextRank_Type tk(std::move(sentences), std::move(tokenized));
+        if (!weights.empty()) {
+            tk.set_node_weights(weights);
+        }
+        tk.set_lazy_convergence(lazy_convergence_);
+        return fn(tk);
+    }
+
+    // Ranks every group of ids (group g starts at ids[group_starts[g]]) as a graph of its own, groups run concurrently
+    // Returns the score of every id within its group
+    std::vector<double> rank_groups(const std::vector<size_t>& ids, const std::vector<size_t>& group_starts) const {
+        std::vector<double> scores(ids.size());
+        size_t num_groups = group_starts.size();
+        Parallel::for_each_block(num_groups, num_threads_, [&](size_t g) {
+            size_t begin = group_starts[g];
+            size_t end = (g + 1 < num_groups) ? group_starts[g + 1] : ids.size();
+            if (begin == end) {
+                return;
+            }
+            std::vector<double> group_scores = rank(std::vector<size_t>(ids.begin() + begin, ids.begin() + end),
+                                                    [](TextRank_Type& tk) { return tk.get_scores(); });
+            std::copy(group_scores.begin(), group_scores.end(), scores.begin() + begin);
+        });
+        return scores;
+    }
+
+    // Keeps the quotas[g] best ids of every group, groups run concurrently
+    // Returns the positions in ids of the winners, in document order
+    std::vector<size_t> group_winners(const std::vector<size_t>& ids, const std::vector<size_t>& group_starts,
+                                      const std::vector<size_t>& quotas) const {
+        size_t num_groups = group_starts.size();
+        std::vector<std::vector<size_t>> group_rankings(num_groups);
+        Parallel::for_each_block(num_groups, num_threads_, [&](size_t g) {
+            size_t begin = group_starts[g];
+            size_t end = (g + 1 < num_groups) ? group_starts[g + 1] : ids.size();
+            if (begin == end) {
+                return;
+            }
+            group_rankings[g] = rank(std::vector<size_t>(ids.begin() + begin, ids.begin() + end),
+                                     [&](TextRank_Type& tk) { return tk.get_ranking(quotas[g]); });
+        });
+        std::vector<size_t> winners;
+        for (size_t g = 0; g < num_groups; g++) {
+            for (size_t k : group_rankings[g]) {
+                winners.push_back(group_starts[g] + k);
+            }
+        }
+        std::sort(winners.begin(), winners.end());
+        return winners;
+    }
+
+    // Starts of consecutive groups of at most group_size of num sentences, as equal as possible
+    static std::vector<size_t> split_groups(size_t num, size_t group_size) {
+        size_t num_groups = (num + group_size - 1) / group_size;
+        std::vector<size_t> group_starts;
+        for (size_t g = 0; g < num_groups; g++) {
+            group_starts.push_back(g * num / num_groups);
+        }
+        return group_starts;
+    }
+
+    strVec get_summary_priv(size_t len) {
+        size_t num = sentences_.size();
+        if (len == 0 || num == 0) {
+            return {};
+        }
+        size_t group_size = MIN_GROUP_SIZE;
+        for (size_t s = 0; s < section_starts_.size(); s++) {
+            size_t end = (s + 1 < section_starts_.size()) ? section_starts_[s + 1] : num;
+            group_size = std::max(group_size, end - section_starts_[s]);
+        }
+
+        // the sentences still competing, in document order, and the groups they are ranked in
+        std::vector<size_t> ids(num);
+        std::iota(ids.begin(), ids.end(), 0);
+        std::vector<size_t> group_starts = section_starts_;
+        std::vector<size_t> summary_sents_i;
+        while (true) {
+            size_t num_groups = group_starts.size();
+            if (num_groups == 1) {
+                for (size_t k : rank(ids, [&](TextRank_Type& tk) { return tk.get_ranking(len); })) {
+                    summary_sents_i.push_back(ids[k]);
+                }
+                break;
+            }
+
+            // the winners of every group go to the next level, unless that does not leave out any sentence
+            std::vector<size_t> quotas(num_groups);
+            size_t num_winners = 0;
+            for (size_t g = 0; g < num_groups; g++) {
+                size_t begin = group_starts[g];
+                size_t end = (g + 1 < num_groups) ? group_starts[g + 1] : ids.size();
+                if (begin == end) {
+                    continue;
+                }
+                double share = OVERSAMPLE * static_cast<double>(len) * static_cast<double>(end - begin)
+                               / static_cast<double>(ids.size());
+                quotas[g] = std::clamp<size_t>(static_cast<size_t>(std::ceil(share)), 1, end - begin);
+                num_winners += quotas[g];
+            }
+            if (num_winners >= ids.size()) {
+                for (size_t k : top_indices(rank_groups(ids, group_starts), len)) {
+                    summary_sents_i.push_back(ids[k]);
+                }
+                break;
+            }
+
+            std::vector<size_t> next_ids;
+            next_ids.reserve(num_winners);
+            for (size_t k : group_winners(ids, group_starts, quotas)) {
+                next_ids.push_back(ids[k]);
+            }
+            ids = std::move(next_ids);
+            group_starts = split_groups(ids.size(), group_size);
+        }
+        std::sort(summary_sents_i.begin(), summary_sents_i.end());
+
+        strVec summary;
+        summary.reserve(summary_sents_i.size());
+        for (size_t i : summary_sents_i) {
+            summary.push_back(sentences_[i]);
+        }
+        return summary;
+    }
+};
+
+#endif //PROJECT_HIERARCHICALTEXTRANK_HPP
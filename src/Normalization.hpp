@@ -0,0 +1,35 @@
+#ifndef PROJECT_NORMALIZATION_HPP
+#define PROJECT_NORMALIZATION_HPP
+
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+// Normalization policies of TextRank, they define the weight an edge carries during the iterations
+// weight(w, norm_from, norm_to) gets the similarity w of the edge and the normalization constants
+// (sums of the weights of all outgoing edges) of the node the score flows from and the node it flows to
+// CONTRACTIVE policies give every node outgoing weights summing to at most 1, so a Jacobi iteration shrinks
+// the total (L1) change of the scores at least by the damping factor, which lazy convergence relies on
+namespace Normalization {
+    // w / (sum of the edges of the source), the source splits its score among its neighbours
+    struct Out_Weight {
+        static constexpr bool CONTRACTIVE = true;
+
+        static double weight(double w, double norm_from, double) {
+            return w / norm_from;
+        }
+    };
+
+    // w / sqrt(sum of the edges of the source * sum of the edges of the target),
+    // damps the influence of hub sentences that are similar to everything
+    struct Symmetric {
+        static constexpr bool CONTRACTIVE = false;
+
+        static double weight(double w, double norm_from, double norm_to) {
+            return w / std::sqrt(norm_from * norm_to);
+        }
+    };
+}
+
+#endif //PROJECT_NORMALIZATION_HPP
@@ -0,0 +1,227 @@
+#ifndef PROJECT_PARALLEL_HPP
+#define PROJECT_PARALLEL_HPP
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef THREAD
+#define THREAD
+#include <thread>
+#endif
+
+#ifndef ATOMIC
+#define ATOMIC
+#include <atomic>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef TYPE_TRAITS
+#define TYPE_TRAITS
+#include <type_traits>
+#endif
+
+#ifndef MUTEX
+#define MUTEX
+#include <mutex>
+#endif
+
+#ifndef CONDITION_VARIABLE
+#define CONDITION_VARIABLE
+#include <condition_variable>
+#endif
+
+#ifndef EXCEPTION
+#define EXCEPTION
+#include <exception>
+#endif
+
+namespace Parallel {
+    // Number of threads the hardware supports, at least 1
+    inline size_t hardware_threads() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Calls fn(block) for every block in [0, num_blocks) using up to num_threads threads
+    // Blocks are handed out dynamically, so the caller must not depend on which thread runs which block
+    // Deterministic results are obtained by writing per-block outputs and reducing them in block order
+    // If fn throws, no new blocks are started and the first exception is rethrown once all threads are joined
+    template <typename Fn>
+    void for_each_block(size_t num_blocks, size_t num_threads, Fn&& fn) {
+        num_threads = std::min(num_threads, num_blocks);
+        if (num_threads <= 1) {
+            for (size_t b = 0; b < num_blocks; b++) {
+                fn(b);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next_block{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        auto worker = [&]() {
+            try {
+                for (size_t b = next_block++; b < num_blocks; b = next_block++) {
+                    fn(b);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next_block = num_blocks;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        try {
+            for (size_t t = 1; t < num_threads; t++) {
+                threads.emplace_back(worker);
+            }
+        }
+        catch (...) {
+            next_block = num_blocks;    // the started threads stop after their current block
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            throw;
+        }
+        worker();   // the calling thread takes part as well
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Threads kept alive between calls of for_each_block, for loops that run many short parallel rounds
+    // (e.g. one per TextRank iteration) where starting new threads every round would cost more than the work
+    class Thread_Team {
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::condition_variable start_;
+        std::condition_variable done_;
+        size_t generation_ = 0;         // number of rounds started, workers wait for it to change
+        size_t running_ = 0;            // workers still in the current round
+        bool stop_ = false;
+
+        // the current round, valid while running_ > 0
+        void (*call_)(void*, size_t) = nullptr;
+        void* context_ = nullptr;
+        size_t num_blocks_ = 0;
+        std::atomic<size_t> next_block_{0};
+        std::exception_ptr error_;      // first exception thrown by a block of the current round
+
+        // Runs blocks until none is left, an exception ends the round for every member and is kept in error_
+        void run_blocks() {
+            try {
+                for (size_t b = next_block_++; b < num_blocks_; b = next_block_++) {
+                    call_(context_, b);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                next_block_ = num_blocks_;
+            }
+        }
+
+        // Stops and joins the workers
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            start_.notify_all();
+            for (auto& thread : threads_) {
+                thread.join();
+            }
+        }
+
+        void work() {
+            size_t seen = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    start_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+                    if (stop_) {
+                        return;
+                    }
+                    seen = generation_;
+                }
+                run_blocks();
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--running_ == 0) {
+                    done_.notify_one();
+                }
+            }
+        }
+
+    public:
+        // Starts num_threads - 1 workers, the thread calling for_each_block is the last member of the team
+        // If a thread cannot be started, the workers already running are joined before the error leaves
+        explicit Thread_Team(size_t num_threads) {
+            try {
+                for (size_t t = 1; t < num_threads; t++) {
+                    threads_.emplace_back(&Thread_Team::work, this);
+                }
+            }
+            catch (...) {
+                stop();
+                throw;
+            }
+        }
+
+        Thread_Team(const Thread_Team&) = delete;
+        Thread_Team& operator=(const Thread_Team&) = delete;
+
+        ~Thread_Team() {
+            stop();
+        }
+
+        [[nodiscard]] size_t size() const { return threads_.size() + 1; }
+
+        // Calls fn(block) for every block in [0, num_blocks) on the team, returns once all blocks are done
+        // Blocks are handed out dynamically like in Parallel::for_each_block
+        // If fn throws, no new blocks are started and the first exception is rethrown once every member is done
+        template <typename Fn>
+        void for_each_block(size_t num_blocks, Fn&& fn) {
+            if (threads_.empty() || num_blocks <= 1) {
+                for (size_t b = 0; b < num_blocks; b++) {
+                    fn(b);
+                }
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                call_ = [](void* context, size_t b) { (*static_cast<std::remove_reference_t<Fn>*>(context))(b); };
+                context_ = const_cast<void*>(static_cast<const void*>(&fn));
+                num_blocks_ = num_blocks;
+                next_block_ = 0;
+                running_ = threads_.size();
+                generation_++;
+            }
+            start_.notify_all();
+            run_blocks();
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&]() { return running_ == 0; });
+            if (error_) {
+                std::exception_ptr error = std::move(error_);
+                error_ = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+    };
+}
+
+#endif //PROJECT_PARALLEL_HPP
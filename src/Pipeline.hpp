@@ -0,0 +1,214 @@
+#ifndef PROJECT_PIPELINE_HPP
+#define PROJECT_PIPELINE_HPP
+
+#ifndef IOSTREAM
+#define IOSTREAM
+#include <iostream>
+#endif
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef UNORDERED_SET
+#define UNORDERED_SET
+#include <unordered_set>
+#endif
+
+#ifndef OPTIONAL
+#define OPTIONAL
+#include <optional>
+#endif
+
+#ifndef ATOMIC
+#define ATOMIC
+#include <atomic>
+#endif
+
+#ifndef THREAD
+#define THREAD
+#include <thread>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef BIT
+#define BIT
+#include <bit>
+#endif
+
+#ifndef EXCEPTION
+#define EXCEPTION
+#include <exception>
+#endif
+
+#include "TextPreprocess.hpp"
+#include "Trace.hpp"
+
+namespace Pipeline {
+    // Number of items buffered between two stages
+    constexpr size_t QUEUE_CAPACITY = 1024;
+
+    // Bounded lock-free queue between exactly one producer and one consumer thread
+    // A full queue blocks the producer and an empty one the consumer, they sleep on the atomic counters
+    // instead of spinning, close() ends the stream after the items already pushed
+    // and cancel() lets a consumer that stops early release a blocked producer
+    template <typename T>
+    class SPSC_Queue {
+        std::vector< std::optional<T> > slots_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> head_{0};   // next slot to pop, written by the consumer
+        alignas(64) std::atomic<size_t> tail_{0};   // next slot to push, written by the producer
+        std::atomic<bool> cancelled_{false};
+
+        void push_slot(std::optional<T>&& value) {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            size_t head = head_.load(std::memory_order_acquire);
+            while (tail - head == slots_.size() && !cancelled()) {
+                head_.wait(head, std::memory_order_acquire);
+                head = head_.load(std::memory_order_acquire);
+            }
+            if (cancelled()) {
+                return;
+            }
+            slots_[tail & mask_] = std::move(value);
+            tail_.store(tail + 1, std::memory_order_release);
+            tail_.notify_one();
+        }
+
+    public:
+        // The capacity is rounded up to a power of two
+        explicit SPSC_Queue(size_t capacity)
+                : slots_(std::bit_ceil(std::max<size_t>(1, capacity))), mask_(slots_.size() - 1) {}
+
+        void push(T value) {
+            push_slot(std::optional<T>(std::move(value)));
+        }
+
+        // Ends the stream, pop returns std::nullopt once the items before were popped
+        void close() {
+            push_slot(std::nullopt);
+        }
+
+        // Called by the consumer when it stops popping, pushes return at once from then on and drop their items
+        void cancel() {
+            cancelled_.store(true, std::memory_order_release);
+            // moving head_ always changes it, which wakes a producer waiting for a free slot
+            head_.fetch_add(slots_.size(), std::memory_order_acq_rel);
+            head_.notify_one();
+        }
+
+        [[nodiscard]] bool cancelled() const {
+            return cancelled_.load(std::memory_order_acquire);
+        }
+
+        std::optional<T> pop() {
+            size_t head = head_.load(std::memory_order_relaxed);
+            size_t tail = tail_.load(std::memory_order_acquire);
+            while (tail == head) {
+                tail_.wait(tail, std::memory_order_acquire);
+                tail = tail_.load(std::memory_order_acquire);
+            }
+            std::optional<T> value = std::move(slots_[head & mask_]);
+            slots_[head & mask_].reset();
+            head_.store(head + 1, std::memory_order_release);
+            head_.notify_one();
+            return value;
+        }
+    };
+
+    // Reads a text and feeds its sentences to ranker.add_sentence(sentence, tokenized_sentence) in order
+    // Reading and splitting, tokenization and ranker insertion run concurrently on three threads (the caller
+    // inserts), connected by queues of capacity sentences, so reading overlaps with building the graph
+    // and at most 2 * capacity sentences wait between the stages
+    // The sentences and tokens are the same as from parse_text_sentences and process_sentences
+    // An exception of any stage cancels the queues so the other stages stop, it is rethrown once all threads joined
+    template <typename Ranker>
+    void feed_sentences(std::istream& in_stream, const std::unordered_set<char>& sent_end_chars,
+                        const std::unordered_set<char>& stop_chars, const std::unordered_set<std::string>& stop_words,
+                        Ranker& ranker, size_t capacity = QUEUE_CAPACITY) {
+        using Tokenized = std::pair< std::string, std::vector<std::string> >;
+        SPSC_Queue<std::string> sentences(capacity);
+        SPSC_Queue<Tokenized> tokenized(capacity);
+        std::exception_ptr reader_error;
+        std::exception_ptr tokenizer_error;
+
+        std::thread reader([&]() {
+            TRACE_SCOPE("read_sentences");
+            struct Sentence_Pusher {
+                SPSC_Queue<std::string>& queue;
+
+                void on_sentence(std::string&& sentence) {
+                    queue.push(std::move(sentence));
+                }
+            } pusher{sentences};
+            try {
+                TextProcess::Sentence_Parser parser(sent_end_chars);
+                char c;
+                while (!sentences.cancelled() && in_stream.get(c)) {
+                    parser.feed(c, pusher);
+                }
+                parser.finish(pusher);
+            }
+            catch (...) {
+                reader_error = std::current_exception();
+            }
+            sentences.close();
+        });
+
+        std::thread tokenizer([&]() {
+            TRACE_SCOPE("tokenize_sentences");
+            try {
+                while (auto sentence = sentences.pop()) {
+                    if (tokenized.cancelled()) {
+                        break;
+                    }
+                    auto tokens = TextProcess::process_sentence(*sentence, stop_chars, stop_words);
+                    tokenized.push(Tokenized(std::move(*sentence), std::move(tokens)));
+                }
+            }
+            catch (...) {
+                tokenizer_error = std::current_exception();
+            }
+            sentences.cancel();     // releases the reader if the tokenizer stopped early
+            tokenized.close();
+        });
+
+        // joins the threads also when add_sentence throws, after cancelling the queue they may be blocked on
+        struct Stage_Joiner {
+            SPSC_Queue<Tokenized>& queue;
+            std::thread& reader;
+            std::thread& tokenizer;
+
+            ~Stage_Joiner() {
+                queue.cancel();
+                tokenizer.join();
+                reader.join();
+            }
+        };
+        {
+            Stage_Joiner joiner{tokenized, reader, tokenizer};
+            TRACE_SCOPE("insert_sentences");
+            while (auto item = tokenized.pop()) {
+                ranker.add_sentence(std::move(item->first), std::move(item->second));
+            }
+        }
+        if (reader_error) {
+            std::rethrow_exception(reader_error);
+        }
+        if (tokenizer_error) {
+            std::rethrow_exception(tokenizer_error);
+        }
+    }
+}
+
+#endif //PROJECT_PIPELINE_HPP
@@ -0,0 +1,334 @@
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef RANDOM
+#define RANDOM
+#include <random>
+#endif
+
+#ifndef CHRONO
+#define CHRONO
+#include <chrono>
+#endif
+
+#ifndef SSTREAM
+#define SSTREAM
+#include <sstream>
+#endif
+
+#ifndef STDEXCEPT
+#define STDEXCEPT
+#include <stdexcept>
+#endif
+
+#include "Planner.hpp"
+#include "SimilarityKernel.hpp"
+#include "HierarchicalTextRank.hpp"
+#include "Trace.hpp"
+
+namespace Planner {
+    namespace {
+        constexpr size_t SAMPLE_PAIRS = 20000;
+        constexpr size_t SAMPLE_ROWS = 64;
+        constexpr double ITERATIONS = 30;                       // typical number of iterations until convergence
+        constexpr double EDGE_BYTES = 24;                       // one direction of an edge, with vector slack
+        constexpr double HEAP_BYTES = 16;                       // candidate edge kept while sparsifying
+        constexpr double POSTING_BYTES = 8;
+        constexpr double NODE_BYTES = sizeof(TextRank_Node) + 64;   // node and its sentence in the similarity corpus
+        constexpr double MIN_EDGE_NS = 0.5;
+
+        // Tried in this order, the first one within the budget is chosen
+        // Few neighbours per sentence lose most of the centrality of long sentences, below 64 the sections
+        // of hierarchical TextRank keep the summary closer to the exact one
+        const std::vector<size_t> SPARSE_EDGES = {512, 256, 128, 64};
+        const std::vector<size_t> SECTION_SIZES = {400, 200, 100, 50};
+        const std::vector<size_t> POSTING_LIMITS = {1000, 300, 100, 30, 10};
+        constexpr size_t APPROXIMATE_EDGES = 128;
+
+        struct Estimator {
+            const Text_Statistics& stats;
+            double edge_ns;
+            double node_memory;
+
+            explicit Estimator(const Text_Statistics& statistics)
+                    : stats(statistics),
+                      edge_ns(std::max(MIN_EDGE_NS, statistics.pair_ns / std::max(1.0, statistics.average_distinct))),
+                      node_memory(static_cast<double>(statistics.sentences) * (NODE_BYTES + 8 * statistics.average_distinct)) {}
+
+            Plan exact() const {
+                Plan plan;
+                double edges = stats.density * stats.pairs;
+                plan.memory = node_memory + 2 * edges * EDGE_BYTES;
+                plan.time_ms = (stats.pairs * stats.pair_ns + ITERATIONS * 2 * edges * edge_ns) / 1e6;
+                return plan;
+            }
+
+            // kept edges of a graph where every sentence keeps max_edges of candidate_edges
+            double kept(double candidate_edges, size_t max_edges) const {
+                return std::min(candidate_edges, static_cast<double>(stats.sentences) * static_cast<double>(max_edges));
+            }
+
+            Plan sparsified(size_t max_edges) const {
+                Plan plan;
+                plan.strategy = SPARSIFIED;
+                plan.limits.max_edges = max_edges;
+                double edges = stats.density * stats.pairs;
+                double kept_edges = kept(edges, max_edges);
+                double heaps = static_cast<double>(stats.sentences) * static_cast<double>(max_edges) * HEAP_BYTES;
+                plan.memory = node_memory + heaps + kept_edges * (EDGE_BYTES + 2 * EDGE_BYTES);
+                plan.time_ms = (stats.pairs * stats.pair_ns + 2 * edges * std::log2(max_edges + 1.0) * edge_ns
+                                + ITERATIONS * 2 * kept_edges * edge_ns) / 1e6;
+                return plan;
+            }
+
+            Plan approximate(size_t max_postings, size_t max_edges) const {
+                Plan plan;
+                plan.strategy = APPROXIMATE;
+                plan.limits.max_postings = max_postings;
+                plan.limits.max_edges = max_edges;
+                double postings = 0;
+                double candidates = 0;
+                for (size_t df : stats.doc_freq) {
+                    if (df <= max_postings) {
+                        postings += static_cast<double>(df);
+                        candidates += static_cast<double>(df) * static_cast<double>(df - 1) / 2;
+                    }
+                }
+                candidates = std::min(candidates, stats.pairs);
+                double kept_edges = kept(candidates, max_edges);
+                double heaps = static_cast<double>(stats.sentences) * static_cast<double>(max_edges) * HEAP_BYTES;
+                plan.memory = node_memory + postings * POSTING_BYTES + heaps + kept_edges * (EDGE_BYTES + 2 * EDGE_BYTES);
+                plan.time_ms = (candidates * stats.pair_ns + 2 * candidates * std::log2(max_edges + 1.0) * edge_ns
+                                + ITERATIONS * 2 * kept_edges * edge_ns) / 1e6;
+                return plan;
+            }
+
+            // Follows the levels of Hierarchical_TextRank, the sections of the first level and then the groups of the
+            // winners of the previous level, which shrink until a level would not leave out any sentence
+            Plan hierarchical(size_t section_size, size_t num_threads, size_t summary_length) const {
+                using Hierarchical = Hierarchical_TextRank<>;
+                Plan plan;
+                plan.strategy = HIERARCHICAL;
+                plan.section_size = section_size;
+                double len = static_cast<double>(std::min(summary_length, stats.sentences));
+                double group_size = static_cast<double>(std::max(Hierarchical::MIN_GROUP_SIZE, section_size));
+                double ids = static_cast<double>(stats.sentences);
+                double groups = std::max(1.0, std::ceil(ids / static_cast<double>(section_size)));
+                double time_ns = 0;
+                double peak_memory = 0;
+                while (true) {
+                    double size = ids / groups;
+                    double pairs = size * std::max(0.0, size - 1) / 2;
+                    double edges = stats.density * pairs;
+                    double concurrent = std::min(groups, static_cast<double>(num_threads));
+                    time_ns += std::ceil(groups / concurrent) * (pairs * stats.pair_ns + ITERATIONS * 2 * edges * edge_ns);
+                    peak_memory = std::max(peak_memory, concurrent * (size * NODE_BYTES + 2 * edges * EDGE_BYTES));
+                    if (groups <= 1) {
+                        break;
+                    }
+                    // every group rounds its share of the winners up
+                    double winners = std::min(ids, Hierarchical::OVERSAMPLE * len + groups);
+                    if (winners >= ids) {
+                        break;
+                    }
+                    ids = winners;
+                    groups = std::ceil(ids / group_size);
+                }
+                plan.memory = node_memory + peak_memory;
+                plan.time_ms = time_ns / 1e6;
+                return plan;
+            }
+        };
+
+        std::string format_bytes(double bytes) {
+            std::ostringstream out;
+            out.precision(3);
+            if (bytes >= 1024.0 * 1024 * 1024) {
+                out << bytes / (1024.0 * 1024 * 1024) << " GB";
+            }
+            else if (bytes >= 1024.0 * 1024) {
+                out << bytes / (1024.0 * 1024) << " MB";
+            }
+            else {
+                out << bytes / 1024.0 << " KB";
+            }
+            return out.str();
+        }
+    }
+
+    // Measures the statistics with the similarity of SimilarityPolicy, sampling at most SAMPLE_PAIRS pairs of sentences
+    template <typename SimilarityPolicy>
+    Text_Statistics measure(const phraseVector& tokenized_sentences) {
+        TRACE_SCOPE("measure_text");
+        Text_Statistics stats;
+        Similarity::Corpus corpus;
+        for (const auto& sentence : tokenized_sentences) {
+            corpus.add_sentence(sentence);
+        }
+        size_t size = corpus.size();
+        stats.sentences = size;
+        stats.pairs = static_cast<double>(size) * static_cast<double>(size > 0 ? size - 1 : 0) / 2;
+        stats.doc_freq.resize(corpus.vocabulary_size());
+        double distinct = 0;
+        for (size_t i = 0; i < size; i++) {
+            distinct += static_cast<double>(corpus[i].ids.size());
+        }
+        stats.average_distinct = size > 0 ? distinct / static_cast<double>(size) : 0;
+        for (Similarity::token_id id = 0; id < stats.doc_freq.size(); id++) {
+            stats.doc_freq[id] = corpus.doc_freq(id);
+        }
+        if (size < 2) {
+            return stats;
+        }
+
+        // rows of the graph are sampled like construct_graph visits them, a row against many other sentences
+        std::mt19937_64 generator(1);
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        size_t rows = std::min(size, SAMPLE_ROWS);
+        size_t per_row = std::max<size_t>(1, std::min(size - 1, SAMPLE_PAIRS / rows));
+        SimilarityPolicy similarity(corpus);
+        Similarity::Row_Probe probe;
+        size_t sampled = 0;
+        size_t similar = 0;
+        double sink = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rows; r++) {
+            size_t i = rows == size ? r : pick(generator);
+            probe.load(corpus, i);
+            for (size_t k = 0; k < per_row; k++) {
+                size_t j = per_row == size - 1 ? (i + 1 + k) % size : pick(generator);
+                if (j == i) {
+                    continue;
+                }
+                double sim = similarity(probe, corpus, j);
+                sink += sim;
+                similar += sim > 0;
+                sampled++;
+            }
+            probe.unload();
+        }
+        double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        stats.density = sampled > 0 ? static_cast<double>(similar) / static_cast<double>(sampled) : 0;
+        stats.pair_ns = sampled > 0 ? elapsed_ns / static_cast<double>(sampled) : 0;
+        if (sink < 0) {     // never true, keeps the sampled similarities from being optimized away
+            stats.density = 1;
+        }
+        return stats;
+    }
+
+    // The estimates of every strategy from the most to the least accurate, for a summary of summary_length sentences
+    std::vector<Plan> candidate_plans(const Text_Statistics& statistics, size_t num_threads, size_t summary_length) {
+        Estimator estimator(statistics);
+        std::vector<Plan> plans = {estimator.exact()};
+        for (size_t max_edges : SPARSE_EDGES) {
+            plans.push_back(estimator.sparsified(max_edges));
+        }
+        for (size_t section_size : SECTION_SIZES) {
+            plans.push_back(estimator.hierarchical(section_size, num_threads, summary_length));
+        }
+        for (size_t max_postings : POSTING_LIMITS) {
+            plans.push_back(estimator.approximate(max_postings, APPROXIMATE_EDGES));
+        }
+        return plans;
+    }
+
+    // The most accurate strategy whose estimates fit the budget, for a summary of summary_length sentences
+    Plan choose(const Text_Statistics& statistics, const Budget& budget, size_t summary_length) {
+        std::vector<Plan> plans = candidate_plans(statistics, budget.num_threads, summary_length);
+
+        auto overrun = [&](const Plan& plan) {
+            return std::max(plan.memory / budget.max_memory, plan.time_ms / budget.deadline_ms);
+        };
+        for (const Plan& plan : plans) {
+            if (overrun(plan) <= 1) {
+                return plan;
+            }
+        }
+        Plan cheapest = *std::min_element(plans.begin(), plans.end(), [&](const Plan& a, const Plan& b) {
+            return overrun(a) < overrun(b);
+        });
+        cheapest.within_budget = false;
+        return cheapest;
+    }
+
+    // One line description of a plan, e.g. "sparsified (64 edges per sentence), estimated 26.8 MB, 1446 ms"
+    std::string describe(const Plan& plan) {
+        std::ostringstream out;
+        switch (plan.strategy) {
+            case EXACT:
+                out << "exact";
+                break;
+            case SPARSIFIED:
+                out << "sparsified (" << plan.limits.max_edges << " edges per sentence)";
+                break;
+            case APPROXIMATE:
+                out << "approximate (words in at most " << plan.limits.max_postings << " sentences, "
+                    << plan.limits.max_edges << " edges per sentence)";
+                break;
+            case HIERARCHICAL:
+                out << "hierarchical (sections of " << plan.section_size << " sentences)";
+                break;
+        }
+        out << ", estimated " << format_bytes(plan.memory) << ", " << static_cast<long long>(std::ceil(plan.time_ms)) << " ms";
+        if (!plan.within_budget) {
+            out << ", over budget";
+        }
+        return out.str();
+    }
+
+    // Parses a number of bytes with an optional K, M or G suffix (powers of 1024), throws std::runtime_error
+    double parse_bytes(const std::string& str) {
+        size_t end = 0;
+        double value;
+        try {
+            value = std::stod(str, &end);
+        }
+        catch (const std::exception&) {
+            throw std::runtime_error("Error: Invalid size " + str + "!");
+        }
+        std::string suffix = str.substr(end);
+        if (!suffix.empty() && (suffix.back() == 'B' || suffix.back() == 'b')) {
+            suffix.pop_back();
+        }
+        double unit = 1;
+        if (suffix == "K" || suffix == "k") {
+            unit = 1024;
+        }
+        else if (suffix == "M" || suffix == "m") {
+            unit = 1024.0 * 1024;
+        }
+        else if (suffix == "G" || suffix == "g") {
+            unit = 1024.0 * 1024 * 1024;
+        }
+        else if (!suffix.empty()) {
+            throw std::runtime_error("Error: Invalid size " + str + "!");
+        }
+        if (!(value > 0)) {
+            throw std::runtime_error("Error: Size " + str + " must be positive!");
+        }
+        return value * unit;
+    }
+
+    // Prebuilt instantiations of measure, one per similarity policy of TextRank
+    template Text_Statistics measure<Similarity::Overlap>(const phraseVector&);
+    template Text_Statistics measure<Similarity::Compat>(const phraseVector&);
+    template Text_Statistics measure<Similarity::Cosine>(const phraseVector&);
+    template Text_Statistics measure<Similarity::BM25>(const phraseVector&);
+}
@@ -0,0 +1,85 @@
+#ifndef PROJECT_PLANNER_HPP
+#define PROJECT_PLANNER_HPP
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef LIMITS
+#define LIMITS
+#include <limits>
+#endif
+
+#include "TextRank.hpp"
+
+// Chooses how TextRank builds its graph so that a text fits a memory and time budget
+// The cost of every strategy is estimated from the number of sentences, the document frequencies of the words
+// and a sample of sentence pairs which gives the density of the graph and the time of one similarity
+namespace Planner {
+    using strVec = std::vector<std::string>;
+    using phraseVector = std::vector< strVec >;
+
+    // From the most to the least accurate
+    // EXACT: all pairs of sentences, the original TextRank
+    // SPARSIFIED: all pairs are compared but every sentence keeps only its most similar neighbours, bounds memory
+    // HIERARCHICAL: fixed size sections ranked on their own, then their best sentences together
+    // APPROXIMATE: only sentences sharing an uncommon word are compared and sparsified, the cheapest for long texts
+    enum Strategy {EXACT, SPARSIFIED, HIERARCHICAL, APPROXIMATE};
+
+    constexpr double UNLIMITED = std::numeric_limits<double>::infinity();
+
+    struct Budget {
+        double max_memory = UNLIMITED;      // bytes of the graph
+        double deadline_ms = UNLIMITED;     // graph construction and iterations
+        size_t num_threads = 1;
+    };
+
+    // Statistics of the tokenized sentences the estimates are based on
+    struct Text_Statistics {
+        size_t sentences = 0;
+        double pairs = 0;                   // n * (n - 1) / 2
+        double density = 0;                 // fraction of pairs with a non-zero similarity, sampled
+        double pair_ns = 0;                 // time of one similarity, sampled
+        double average_distinct = 0;        // distinct words per sentence
+        std::vector<size_t> doc_freq;       // sentences containing each word
+    };
+
+    struct Plan {
+        Strategy strategy = EXACT;
+        Graph_Limits limits;                // SPARSIFIED and APPROXIMATE
+        size_t section_size = 0;            // HIERARCHICAL
+        double memory = 0;                  // estimated bytes
+        double time_ms = 0;                 // estimated milliseconds
+        bool within_budget = true;          // false if no strategy fits, the plan is then the cheapest one
+    };
+
+    // Measures the statistics with the similarity of SimilarityPolicy, sampling at most SAMPLE_PAIRS pairs of sentences
+    template <typename SimilarityPolicy = Similarity::Overlap>
+    Text_Statistics measure(const phraseVector& tokenized_sentences);
+
+    // The estimates of every strategy from the most to the least accurate, for a summary of summary_length sentences
+    std::vector<Plan> candidate_plans(const Text_Statistics& statistics, size_t num_threads, size_t summary_length);
+
+    // The most accurate strategy whose estimates fit the budget, for a summary of summary_length sentences
+    Plan choose(const Text_Statistics& statistics, const Budget& budget, size_t summary_length);
+
+    // One line description of a plan, e.g. "sparsified (64 edges per sentence), estimated 26.8 MB, 1446 ms"
+    std::string describe(const Plan& plan);
+
+    // Parses a number of bytes with an optional K, M or G suffix (powers of 1024), throws std::runtime_error
+    double parse_bytes(const std::string& str);
+
+    // Prebuilt instantiations of measure, defined in Planner.cpp
+    extern template Text_Statistics measure<Similarity::Overlap>(const phraseVector&);
+    extern template Text_Statistics measure<Similarity::Compat>(const phraseVector&);
+    extern template Text_Statistics measure<Similarity::Cosine>(const phraseVector&);
+    extern template Text_Statistics measure<Similarity::BM25>(const phraseVector&);
+}
+
+#endif //PROJECT_PLANNER_HPP
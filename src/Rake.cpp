@@ -33,19 +33,31 @@
 #include <set>
 #endif
 
+#ifndef UNORDERED_MAP
+#define UNORDERED_MAP
+#include <unordered_map>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
 #ifndef FUNCTIONAL
 #define FUNCTIONAL
 #include <functional>
 #endif
 
 #include "Rake.hpp"
+#include "Trace.hpp"
+#include "Parallel.hpp"
 
 using strVec = std::vector<std::string>;
 using phraseVector = std::vector< strVec >;
 
 // Constructor accepting phrases by l-value reference, and copying them
 // Original phrases left untouched
-RAKE::RAKE(RAKE::phraseVector& phrases) {
+RAKE::RAKE(RAKE::phraseVector& phrases) : num_phrases_(phrases.size()) {
     for (auto& phrase : phrases) {
         phrases_with_scores_.emplace_back(phrase, 0);
     }
@@ -53,67 +65,270 @@ RAKE::RAKE(RAKE::phraseVector& phrases) {
 
 // Constructor accepting phrases by r-value reference, moving them
 // Original phrases moved
-RAKE::RAKE(RAKE::phraseVector&& phrases) {
+RAKE::RAKE(RAKE::phraseVector&& phrases) : num_phrases_(phrases.size()) {
     for (auto&& phrase : phrases) {
         phrases_with_scores_.emplace_back(std::move(phrase), 0);
     }
 }
 
+// Constructor from the merged statistics of a text, ranks like RAKE over the whole text
+// Adjoined phrases seen at least min_adjoined_count times become extra candidates (0 = none),
+// their stop words do not contribute to word statistics nor scores
+RAKE::RAKE(const Rake_Snapshot& snapshot, size_t min_adjoined_count)
+        : word_scores_(snapshot.word_scores_), num_phrases_(snapshot.num_phrases_), words_counted(true) {
+    phrases_with_scores_.reserve(snapshot.phrase_counts_.size());
+    for (const auto& phrase_count : snapshot.phrase_counts_) {
+        phrases_with_scores_.emplace_back(phrase_count.first, 0);
+    }
+    if (min_adjoined_count == 0) {
+        return;
+    }
+    for (const auto& phrase_count : snapshot.adjoined_counts_) {
+        if (phrase_count.second >= min_adjoined_count) {
+            phrases_with_scores_.emplace_back(phrase_count.first, 0);
+            num_phrases_++;
+        }
+    }
+}
+
+// Returns the statistics of the phrases, to be merged with those of other parts of the text
+Rake_Snapshot RAKE::snapshot() const {
+    if (words_counted || calculated) {
+        throw std::runtime_error("Error: Snapshot of RAKE has to be taken before the phrases are ranked!");
+    }
+    phraseVector phrases;
+    phrases.reserve(phrases_with_scores_.size());
+    for (const auto& pair_phrase_score : phrases_with_scores_) {
+        phrases.push_back(pair_phrase_score.first);
+    }
+    return Rake_Snapshot(phrases);
+}
+
 // Returns a percentages, provided by the user, of all the phrases
 phraseVector RAKE::get_key_phrases(double percent) {
+    return get_key_phrases_priv(key_phrases_length(percent));
+}
+
+// Returns the top len_i phrases
+phraseVector RAKE::get_key_phrases(int len_i) {
+    return get_key_phrases_priv(key_phrases_length(len_i));
+}
+
+// Number of key phrases given by a percentage of all the phrases, throws if the percentage is not in [0, 1]
+size_t RAKE::key_phrases_length(double percent) const {
     if (percent < 0 || percent > 1) {
         throw std::runtime_error("Error: Percentage of phrases included in the summary should be between 0 and 1!");
     }
-    size_t num = static_cast<size_t>(static_cast<double>(phrases_with_scores_.size()) * percent);
-    return get_key_phrases_priv(num);
+    return static_cast<size_t>(static_cast<double>(num_phrases_) * percent);
 }
 
-// Returns the top len_i phrases
-phraseVector RAKE::get_key_phrases(int len_i) {
+// Number of key phrases given by the user, throws if negative and warns if more than all the phrases
+size_t RAKE::key_phrases_length(int len_i) const {
     if (len_i < 0) {
         throw std::runtime_error("Error: Length of summary cannot be negative!");
     }
     size_t len = static_cast<size_t>(len_i);
-    if (len > phrases_with_scores_.size()) {
+    if (len > num_phrases_) {
         std::cerr << "Warning: Number of phrases requested in the summary is greater than the total number of phrases" << std::endl;
     }
-    len = std::min(len, phrases_with_scores_.size());
-    return get_key_phrases_priv(len);
+    return std::min(len, num_phrases_);
 }
 
 phraseVector RAKE::get_key_phrases_priv(size_t num) {
-    if (!calculated) {
+    auto key_phrases = key_phrases_view_priv(num);
+    return phraseVector(key_phrases.begin(), key_phrases.end());
+}
+
+// Ranks the phrases once, returns how many of the num requested exist after removing duplicates
+size_t RAKE::calculate(size_t num) {
+    if (!calculated && num_threads_ == 1 && !scored) {
         set_scores();
         rem_duplicates_sort();
         calculated = true;
     }
+    else if (!calculated && num > ranked_count_) {
+        if (!scored) {
+            set_scores_parallel();
+        }
+        rank_parallel(num);
+    }
+    if (calculated) {
+        // duplicates were removed, there might be less phrases left than requested
+        return std::min(num, phrases_with_scores_.size());
+    }
+    return std::min(num, ranked_count_);
+}
 
-    phraseVector result;
-    for (size_t i = 0; i < num; i++){
-        result.push_back(phrases_with_scores_[i].first);
+// Sets the number of threads used to score and rank the phrases, 1 runs the original sequential algorithm
+// With more threads only the requested number of top phrases is ranked, the order is the same
+void RAKE::set_threads(size_t num_threads) {
+    if (num_threads == 0) {
+        throw std::runtime_error("Error: Number of threads must be positive!");
     }
-    return result;
+    num_threads_ = num_threads;
 }
 
 void RAKE::set_scores() {
-    // score each word
-    for (const auto& pair_phrase_score : phrases_with_scores_) {
-        size_t phrase_len = pair_phrase_score.first.size();
-        for (const auto& word : pair_phrase_score.first) {
+    TRACE_SCOPE("set_scores");
+    // score each word, unless the statistics came from a snapshot
+    for (size_t i = 0; i < phrases_with_scores_.size() && !words_counted; i++) {
+        size_t phrase_len = phrases_with_scores_[i].first.size();
+        for (const auto& word : phrases_with_scores_[i].first) {
             word_scores_[word].incr_same();
             word_scores_[word].incr_deg(phrase_len);
         }
     }
+    words_counted = true;
     // sum up scores for each sentence
     for (auto& pair_phrase_score : phrases_with_scores_) {
         double phrase_score = 0;
         for (auto& word : pair_phrase_score.first) {
-            phrase_score += word_scores_[word].score();
+            auto word_score = word_scores_.find(word);
+            if (word_score != word_scores_.end()) {     // stop words of adjoined phrases have no score
+                phrase_score += word_score->second.score();
+            }
         }
         pair_phrase_score.second = phrase_score;
     }
 }
 
+// set_scores on num_threads_ threads, words are counted into per thread hash shards merged by key
+void RAKE::set_scores_parallel() {
+    TRACE_SCOPE("set_scores_parallel");
+    using Shard = std::unordered_map<std::string, Rake_WordScore>;
+    size_t num_shards = num_threads_;
+    size_t size = phrases_with_scores_.size();
+    std::hash<std::string> hasher;
+    auto part_begin = [&](size_t part) { return part * size / num_threads_; };
+
+    std::vector<Shard> shards(num_shards);
+    if (!words_counted) {
+        // every thread counts its part of the phrases, split by the shard of the word
+        std::vector< std::vector<Shard> > local(num_threads_, std::vector<Shard>(num_shards));
+        Parallel::for_each_block(num_threads_, num_threads_, [&](size_t part) {
+            for (size_t i = part_begin(part); i < part_begin(part + 1); i++) {
+                size_t phrase_len = phrases_with_scores_[i].first.size();
+                for (const auto& word : phrases_with_scores_[i].first) {
+                    Rake_WordScore& word_score = local[part][hasher(word) % num_shards][word];
+                    word_score.incr_same();
+                    word_score.incr_deg(phrase_len);
+                }
+            }
+        });
+        // every thread merges one shard, counts are integers so the order does not matter
+        Parallel::for_each_block(num_shards, num_threads_, [&](size_t shard) {
+            for (size_t part = 0; part < num_threads_; part++) {
+                for (const auto& word_score : local[part][shard]) {
+                    shards[shard][word_score.first].merge(word_score.second);
+                }
+            }
+        });
+    }
+    else {
+        Parallel::for_each_block(num_shards, num_threads_, [&](size_t shard) {
+            for (const auto& word_score : word_scores_) {
+                if (hasher(word_score.first) % num_shards == shard) {
+                    shards[shard].emplace(word_score.first, word_score.second);
+                }
+            }
+        });
+    }
+    words_counted = true;
+
+    // the words of a phrase are added in the same order as set_scores, so the sums are identical
+    Parallel::for_each_block(num_threads_, num_threads_, [&](size_t part) {
+        for (size_t i = part_begin(part); i < part_begin(part + 1); i++) {
+            double phrase_score = 0;
+            for (const auto& word : phrases_with_scores_[i].first) {
+                const Shard& shard = shards[hasher(word) % num_shards];
+                auto word_score = shard.find(word);
+                if (word_score != shard.end()) {     // stop words of adjoined phrases have no score
+                    phrase_score += word_score->second.score();
+                }
+            }
+            phrases_with_scores_[i].second = phrase_score;
+        }
+    });
+    scored = true;
+}
+
+// Ranks at least the top num distinct phrases on num_threads_ threads, each thread sorts and deduplicates
+// the top num phrases of its part, the parts are merged with custom_comp
+void RAKE::rank_parallel(size_t num) {
+    TRACE_SCOPE("rank_parallel");
+    size_t size = phrases_with_scores_.size();
+    auto part_begin = [&](size_t part) { return part * size / num_threads_; };
+    auto less = [&](size_t a, size_t b) { return custom_comp(phrases_with_scores_[a], phrases_with_scores_[b]); };
+    // equal phrases have equal scores, so they are neighbours once sorted
+    auto same = [&](size_t a, size_t b) { return phrases_with_scores_[a].first == phrases_with_scores_[b].first; };
+
+    std::vector< std::vector<size_t> > tops(num_threads_);
+    std::vector<char> truncated(num_threads_, 0);     // the part has distinct phrases beyond its top
+    Parallel::for_each_block(num_threads_, num_threads_, [&](size_t part) {
+        std::vector<size_t>& top = tops[part];
+        for (size_t i = part_begin(part); i < part_begin(part + 1); i++) {
+            top.push_back(i);
+        }
+        size_t m = std::min(num, top.size());
+        std::partial_sort(top.begin(), top.begin() + static_cast<std::ptrdiff_t>(m), top.end(), less);
+        size_t distinct = static_cast<size_t>(std::unique(top.begin(), top.begin() + static_cast<std::ptrdiff_t>(m), same) - top.begin());
+        if (distinct < m && m < top.size()) {
+            // duplicates among the top, the rest of the part is needed after all
+            std::sort(top.begin(), top.end(), less);
+            distinct = static_cast<size_t>(std::unique(top.begin(), top.end(), same) - top.begin());
+            truncated[part] = distinct > num;
+        }
+        else {
+            truncated[part] = m < top.size();
+        }
+        top.resize(std::min(distinct, num));
+    });
+
+    // merge the sorted tops, skipping phrases another part already contributed
+    std::vector<size_t> ranked;
+    std::vector<size_t> next(num_threads_, 0);
+    while (ranked.size() < num) {
+        size_t best_part = num_threads_;
+        for (size_t part = 0; part < num_threads_; part++) {
+            if (next[part] < tops[part].size() &&
+                (best_part == num_threads_ || less(tops[part][next[part]], tops[best_part][next[best_part]]))) {
+                best_part = part;
+            }
+        }
+        if (best_part == num_threads_) {
+            break;
+        }
+        size_t index = tops[best_part][next[best_part]++];
+        if (ranked.empty() || !same(ranked.back(), index)) {
+            ranked.push_back(index);
+        }
+    }
+    bool complete = ranked.size() < num || std::none_of(truncated.begin(), truncated.end(), [](char t) { return t != 0; });
+    if (complete) {
+        // every distinct phrase was merged, whatever was left are duplicates
+        for (size_t part = 0; part < num_threads_ && complete; part++) {
+            complete = next[part] == tops[part].size();
+        }
+    }
+
+    // the ranked phrases first, then the rest for a later call asking for more
+    std::vector< std::pair<strVec, double> > reordered;
+    reordered.reserve(complete ? ranked.size() : size);
+    std::vector<char> taken(size, 0);
+    for (size_t index : ranked) {
+        reordered.push_back(std::move(phrases_with_scores_[index]));
+        taken[index] = 1;
+    }
+    for (size_t i = 0; i < size && !complete; i++) {
+        if (!taken[i]) {
+            reordered.push_back(std::move(phrases_with_scores_[i]));
+        }
+    }
+    phrases_with_scores_ = std::move(reordered);
+    ranked_count_ = ranked.size();
+    calculated = complete;
+}
+
 // my comparator function for std::pair< phrase, score >
 // First compares by scores in decreasing order
 // If scores are the same, compares strVec lexicographically
@@ -126,6 +341,7 @@ bool RAKE::custom_comp(const std::pair<strVec, double>& a, const std::pair<strVe
 
 // remove duplicates from phrases_with_scores
 void RAKE::rem_duplicates_sort() {
+    TRACE_SCOPE("rem_duplicates_sort");
     // set to keep elements
     std::set< std::pair<strVec, double>,
     std::function<bool(std::pair<strVec, double>, std::pair<strVec, double>)> > phr_score_set(custom_comp);
@@ -141,3 +357,123 @@ void RAKE::rem_duplicates_sort() {
               phr_score_set.end(),
               std::back_inserter(phrases_with_scores_));
 }
+
+// Collects the statistics of phrases
+Rake_Snapshot::Rake_Snapshot(const phraseVector& phrases) : num_phrases_(phrases.size()) {
+    TRACE_SCOPE("count_phrases");
+    for (const auto& phrase : phrases) {
+        for (const auto& word : phrase) {
+            word_scores_[word].incr_same();
+            word_scores_[word].incr_deg(phrase.size());
+        }
+        phrase_counts_[phrase]++;
+    }
+}
+
+// Adds counts of adjoined phrases (see TextProcess::parse_text_phrases_adjoined)
+void Rake_Snapshot::add_adjoined(const std::vector< std::pair<strVec, size_t> >& adjoined) {
+    for (const auto& phrase_count : adjoined) {
+        adjoined_counts_[phrase_count.first] += phrase_count.second;
+    }
+}
+
+// Adds the statistics of other, the result is the snapshot of both texts together
+void Rake_Snapshot::merge(const Rake_Snapshot& other) {
+    for (const auto& word_score : other.word_scores_) {
+        word_scores_[word_score.first].merge(word_score.second);
+    }
+    for (const auto& phrase_count : other.phrase_counts_) {
+        phrase_counts_[phrase_count.first] += phrase_count.second;
+    }
+    for (const auto& phrase_count : other.adjoined_counts_) {
+        adjoined_counts_[phrase_count.first] += phrase_count.second;
+    }
+    num_phrases_ += other.num_phrases_;
+}
+
+// Writes the snapshot in a line based text format read by deserialize
+// Words never contain white space, the parser splits on it
+void Rake_Snapshot::serialize(std::ostream& out_stream) const {
+    out_stream << "RAKE_SNAPSHOT 2\n";
+    out_stream << "phrases " << num_phrases_ << "\n";
+    out_stream << "words " << word_scores_.size() << "\n";
+    for (const auto& word_score : word_scores_) {
+        out_stream << word_score.first << " " << word_score.second.get_freq() << " " << word_score.second.get_deg() << "\n";
+    }
+    auto write_phrase_counts = [&](const std::string& keyword, const std::map<strVec, size_t>& counts) {
+        out_stream << keyword << " " << counts.size() << "\n";
+        for (const auto& phrase_count : counts) {
+            out_stream << phrase_count.second << " " << phrase_count.first.size();
+            for (const auto& word : phrase_count.first) {
+                out_stream << " " << word;
+            }
+            out_stream << "\n";
+        }
+    };
+    write_phrase_counts("unique", phrase_counts_);
+    write_phrase_counts("adjoined", adjoined_counts_);
+}
+
+// Reads a snapshot written by serialize, throws std::runtime_error if the input is malformed
+// Version 1 snapshots have no adjoined phrases
+Rake_Snapshot Rake_Snapshot::deserialize(std::istream& in_stream) {
+    auto expect = [&](const std::string& keyword) {
+        std::string token;
+        if (!(in_stream >> token) || token != keyword) {
+            throw std::runtime_error("Error: Malformed RAKE snapshot, expected " + keyword + "!");
+        }
+    };
+    auto read_count = [&]() {
+        size_t count;
+        if (!(in_stream >> count)) {
+            throw std::runtime_error("Error: Malformed RAKE snapshot, expected a number!");
+        }
+        return count;
+    };
+    auto read_word = [&]() {
+        std::string word;
+        if (!(in_stream >> word)) {
+            throw std::runtime_error("Error: Malformed RAKE snapshot, expected a word!");
+        }
+        return word;
+    };
+
+    auto read_phrase_counts = [&](std::map<strVec, size_t>& counts) {
+        size_t num_unique = read_count();
+        for (size_t i = 0; i < num_unique; i++) {
+            size_t count = read_count();
+            // the length comes from the input, the words are appended as they are read instead of allocated up front,
+            // so a corrupt length runs out of words and throws like any other malformed snapshot
+            size_t length = read_count();
+            strVec phrase;
+            for (size_t w = 0; w < length; w++) {
+                phrase.push_back(read_word());
+            }
+            counts.emplace_hint(counts.end(), std::move(phrase), count);
+        }
+    };
+
+    Rake_Snapshot snapshot;
+    expect("RAKE_SNAPSHOT");
+    size_t version = read_count();
+    if (version != 1 && version != 2) {
+        throw std::runtime_error("Error: Unsupported RAKE snapshot version " + std::to_string(version) + "!");
+    }
+    expect("phrases");
+    snapshot.num_phrases_ = read_count();
+    expect("words");
+    size_t num_words = read_count();
+    for (size_t i = 0; i < num_words; i++) {
+        std::string word = read_word();
+        Rake_WordScore::type freq = read_count();
+        Rake_WordScore::type deg = read_count();
+        snapshot.word_scores_.emplace_hint(snapshot.word_scores_.end(), std::move(word), Rake_WordScore(freq, deg));
+    }
+    expect("unique");
+    read_phrase_counts(snapshot.phrase_counts_);
+    if (version >= 2) {
+        expect("adjoined");
+        read_phrase_counts(snapshot.adjoined_counts_);
+    }
+    return snapshot;
+}
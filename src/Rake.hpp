@@ -36,6 +36,11 @@
 #include <set>
 #endif
 
+#ifndef RANGES
+#define RANGES
+#include <ranges>
+#endif
+
 #ifndef FUNCTIONAL
 #define FUNCTIONAL
 #include <functional>
@@ -44,10 +49,16 @@
 
 // Class that handles word scores
 class Rake_WordScore {
-    using type = unsigned int;
+public:
+    using type = size_t;    // merged snapshots of a large corpus overflow 32 bit counts
+private:
     type freq = 0;
     type deg = 0;
 public:
+    Rake_WordScore() = default;
+
+    Rake_WordScore(type freq_, type deg_) : freq(freq_), deg(deg_) {}
+
     void incr_deg(size_t x) { deg += x; }
 
     void incr_same() {freq++; }
@@ -59,6 +70,52 @@ public:
     bool operator<(const Rake_WordScore& other) const{
         return this->score() < other.score();
     }
+
+    // Adds the counts of the same word from another part of the text
+    void merge(const Rake_WordScore& other) {
+        freq += other.freq;
+        deg += other.deg;
+    }
+
+    [[nodiscard]] type get_freq() const { return freq; }
+
+    [[nodiscard]] type get_deg() const { return deg; }
+};
+
+
+// Word statistics and phrase counts of the phrases of a text, everything RAKE needs to score them
+// The snapshot of a concatenation of texts is the merge of their snapshots, in any order and grouping,
+// so shards of a corpus can be processed by separate processes and reduced in a tree
+class Rake_Snapshot {
+    using strVec = std::vector<std::string>;
+    using phraseVector = std::vector< strVec >;
+
+    std::map<std::string, Rake_WordScore> word_scores_;
+    std::map<strVec, size_t> phrase_counts_;
+    std::map<strVec, size_t> adjoined_counts_;   // phrases joined by a single stop word, stop word included
+    size_t num_phrases_ = 0;     // including duplicates
+
+    friend class RAKE;
+
+public:
+    Rake_Snapshot() = default;
+
+    // Collects the statistics of phrases
+    explicit Rake_Snapshot(const phraseVector& phrases);
+
+    // Adds counts of adjoined phrases (see TextProcess::parse_text_phrases_adjoined)
+    void add_adjoined(const std::vector< std::pair<strVec, size_t> >& adjoined);
+
+    // Adds the statistics of other, the result is the snapshot of both texts together
+    void merge(const Rake_Snapshot& other);
+
+    // Writes the snapshot in a line based text format read by deserialize
+    void serialize(std::ostream& out_stream) const;
+
+    // Reads a snapshot written by serialize, throws std::runtime_error if the input is malformed
+    static Rake_Snapshot deserialize(std::istream& in_stream);
+
+    [[nodiscard]] size_t num_phrases() const { return num_phrases_; }
 };
 
 
@@ -68,7 +125,13 @@ class RAKE {
 
     std::map<std::string, Rake_WordScore> word_scores_;
     std::vector< std::pair<strVec, double> > phrases_with_scores_;
-    bool calculated = false;
+    size_t num_phrases_ = 0;        // number of phrases including duplicates
+    bool words_counted = false;     // word_scores_ already hold the statistics (RAKE built from a snapshot)
+    bool calculated = false;        // all phrases are ranked and duplicates removed
+
+    size_t num_threads_ = 1;
+    bool scored = false;            // scores of phrases_with_scores_ are set
+    size_t ranked_count_ = 0;       // phrases_with_scores_ starts with this many ranked distinct phrases
 
 public:
     // Constructor accepting phrases by l-value reference, and copying them
@@ -79,17 +142,59 @@ public:
     // Original phrases moved
     explicit RAKE(phraseVector&& phrases);
 
+    // Constructor from the merged statistics of a text, ranks like RAKE over the whole text
+    // Adjoined phrases seen at least min_adjoined_count times become extra candidates (0 = none),
+    // their stop words do not contribute to word statistics nor scores
+    explicit RAKE(const Rake_Snapshot& snapshot, size_t min_adjoined_count = 0);
+
+    // Returns the statistics of the phrases, to be merged with those of other parts of the text
+    [[nodiscard]] Rake_Snapshot snapshot() const;
+
     // Returns a percentages, provided by the user, of all the phrases
     phraseVector get_key_phrases(double percent = static_cast<double>(1) / 3);
 
     // Returns the top len_i phrases
     phraseVector get_key_phrases(int len_i);
 
+    // Lazy view of the top phrases from the best one, like get_key_phrases without copying the phrases
+    // Valid until the RAKE is destroyed or, with several threads, asked for more phrases than before
+    auto key_phrases_view(double percent = static_cast<double>(1) / 3);
+
+    auto key_phrases_view(int len_i);
+
+    // Sets the number of threads used to score and rank the phrases, 1 runs the original sequential algorithm
+    // With more threads only the requested number of top phrases is ranked, the order is the same
+    void set_threads(size_t num_threads);
+
 private:
+    // Number of key phrases given by a percentage of all the phrases, throws if the percentage is not in [0, 1]
+    size_t key_phrases_length(double percent) const;
+
+    // Number of key phrases given by the user, throws if negative and warns if more than all the phrases
+    size_t key_phrases_length(int len_i) const;
+
     phraseVector get_key_phrases_priv(size_t num);
 
+    // Ranks the phrases once, returns how many of the num requested exist after removing duplicates
+    size_t calculate(size_t num);
+
+    auto key_phrases_view_priv(size_t num) {
+        return phrases_with_scores_
+               | std::views::take(calculate(num))
+               | std::views::transform([](const std::pair<strVec, double>& pair_phrase_score) -> const strVec& {
+                     return pair_phrase_score.first;
+                 });
+    }
+
     void set_scores();
 
+    // set_scores on num_threads_ threads, words are counted into per thread hash shards merged by key
+    void set_scores_parallel();
+
+    // Ranks at least the top num distinct phrases on num_threads_ threads, each thread sorts and deduplicates
+    // the top num phrases of its part, the parts are merged with custom_comp
+    void rank_parallel(size_t num);
+
     // my comparator function for std::pair< phrase, score >
     // First compares by scores in decreasing order
     // If scores are the same, compares strVec lexicographically
@@ -99,4 +204,14 @@ private:
     void rem_duplicates_sort();
 };
 
+// Lazy view of the top phrases from the best one, like get_key_phrases without copying the phrases
+// Valid until the RAKE is destroyed or, with several threads, asked for more phrases than before
+inline auto RAKE::key_phrases_view(double percent) {
+    return key_phrases_view_priv(key_phrases_length(percent));
+}
+
+inline auto RAKE::key_phrases_view(int len_i) {
+    return key_phrases_view_priv(key_phrases_length(len_i));
+}
+
 #endif //PROJECT_RAKE_HPP
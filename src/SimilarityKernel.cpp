@@ -0,0 +1,108 @@
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#include "SimilarityKernel.hpp"
+
+namespace Similarity {
+    // Converts a tokenized sentence and appends it, returns its index
+    size_t Corpus::add_sentence(const strVec& words) {
+        std::vector<token_id> ids;
+        ids.reserve(words.size());
+        for (const auto& word : words) {
+            auto it = vocabulary_.try_emplace(word, static_cast<token_id>(vocabulary_.size())).first;
+            ids.push_back(it->second);
+        }
+        std::sort(ids.begin(), ids.end());
+
+        Sentence_Tokens sentence;
+        sentence.length = words.size();
+        total_length_ += words.size();
+        sentence.log_length = std::log(static_cast<double>(words.size()));
+        for (size_t k = 0; k < ids.size(); k++) {
+            if (sentence.ids.empty() || sentence.ids.back() != ids[k]) {
+                if (ids[k] >= doc_freq_.size()) {
+                    doc_freq_.resize(ids[k] + 1, 0);
+                }
+                doc_freq_[ids[k]]++;
+                sentence.ids.push_back(ids[k]);
+                sentence.counts.push_back(1);
+            }
+            else {
+                sentence.counts.back()++;
+            }
+        }
+        sentences_.push_back(std::move(sentence));
+        return sentences_.size() - 1;
+    }
+
+    // Makes sentence i of the corpus the one others are intersected with
+    void Row_Probe::load(const Corpus& corpus, size_t i) {
+        if (slot_.size() < corpus.vocabulary_size()) {
+            slot_.resize(corpus.vocabulary_size(), 0);
+        }
+        const Sentence_Tokens& row = corpus[i];
+        row_ = &row;
+        row_index_ = i;
+        for (size_t k = 0; k < row.ids.size(); k++) {
+            slot_[row.ids[k]] = static_cast<uint32_t>(k + 1);
+        }
+    }
+
+    // Resets the slots of the current row, cost proportional to the row and not to the vocabulary
+    void Row_Probe::unload() {
+        if (row_ == nullptr) {
+            return;
+        }
+        for (token_id id : row_->ids) {
+            slot_[id] = 0;
+        }
+        row_ = nullptr;
+    }
+
+    // Smoothed inverse document frequency, ln((1 + N) / (1 + df)) + 1, never zero
+    Cosine::Cosine(const Corpus& corpus) : idf_(corpus.vocabulary_size()), norms_(corpus.size()) {
+        double num = static_cast<double>(corpus.size());
+        for (token_id id = 0; id < idf_.size(); id++) {
+            idf_[id] = std::log((1 + num) / (1 + corpus.doc_freq(id))) + 1;
+        }
+        for (size_t i = 0; i < corpus.size(); i++) {
+            double sum = 0;
+            for (size_t k = 0; k < corpus[i].ids.size(); k++) {
+                double w = corpus[i].counts[k] * idf_[corpus[i].ids[k]];
+                sum += w * w;
+            }
+            norms_[i] = std::sqrt(sum);
+        }
+    }
+
+    // Probabilistic inverse document frequency, ln((N - df + 0.5) / (df + 0.5) + 1), never negative
+    BM25::BM25(const Corpus& corpus) : idf_(corpus.vocabulary_size()), length_norm_(corpus.size()) {
+        double num = static_cast<double>(corpus.size());
+        for (token_id id = 0; id < idf_.size(); id++) {
+            double df = corpus.doc_freq(id);
+            idf_[id] = std::log((num - df + 0.5) / (df + 0.5) + 1);
+        }
+        double average = corpus.average_length();
+        for (size_t i = 0; i < corpus.size(); i++) {
+            double relative = average > 0 ? static_cast<double>(corpus[i].length) / average : 1;
+            length_norm_[i] = K1 * (1 - B + B * relative);
+        }
+    }
+}
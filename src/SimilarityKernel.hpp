@@ -0,0 +1,232 @@
+#ifndef PROJECT_SIMILARITYKERNEL_HPP
+#define PROJECT_SIMILARITYKERNEL_HPP
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef UNORDERED_MAP
+#define UNORDERED_MAP
+#include <unordered_map>
+#endif
+
+#ifndef CSTDINT
+#define CSTDINT
+#include <cstdint>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+namespace Similarity {
+    using strVec = std::vector<std::string>;
+    using token_id = uint32_t;
+
+    // A sentence prepared for the similarity kernel
+    struct Sentence_Tokens {
+        std::vector<token_id> ids;          // sorted distinct token ids
+        std::vector<uint32_t> counts;       // counts[k] = number of occurrences of ids[k] in the sentence
+        size_t length = 0;                  // number of words including duplicates
+        double log_length = 0;              // log(length), cached for every pair the sentence is part of
+    };
+
+    // Interns the words of tokenized sentences into dense ids
+    class Corpus {
+        std::unordered_map<std::string, token_id> vocabulary_;
+        std::vector<Sentence_Tokens> sentences_;
+        std::vector<uint32_t> doc_freq_;    // doc_freq_[id] = number of sentences containing the token
+        size_t total_length_ = 0;           // number of words in all sentences
+
+    public:
+        // Converts a tokenized sentence and appends it, returns its index
+        size_t add_sentence(const strVec& words);
+
+        [[nodiscard]] const Sentence_Tokens& operator[](size_t i) const { return sentences_[i]; }
+
+        [[nodiscard]] size_t size() const { return sentences_.size(); }
+
+        [[nodiscard]] size_t vocabulary_size() const { return vocabulary_.size(); }
+
+        [[nodiscard]] uint32_t doc_freq(token_id id) const { return doc_freq_[id]; }
+
+        [[nodiscard]] double average_length() const {
+            return sentences_.empty() ? 0 : static_cast<double>(total_length_) / static_cast<double>(sentences_.size());
+        }
+    };
+
+    // Calls fn(k_small, k_large) for every token shared by two sentences, k_* are positions in their ids
+    // Exponential search over the remaining ids of the larger sentence, cheap when it is much longer
+    template <typename Fn>
+    void gallop_common(const Sentence_Tokens& small, const Sentence_Tokens& large, Fn&& fn) {
+        auto begin = large.ids.begin();
+        auto end = large.ids.end();
+        for (size_t k = 0; k < small.ids.size() && begin != end; k++) {
+            token_id id = small.ids[k];
+            size_t step = 1;
+            auto hi = begin;
+            while (hi != end && *hi < id) {
+                begin = hi;
+                hi = (static_cast<size_t>(end - hi) > step) ? hi + step : end;
+                step *= 2;
+            }
+            begin = std::lower_bound(begin, hi, id);
+            if (begin != end && *begin == id) {
+                fn(k, static_cast<size_t>(begin - large.ids.begin()));
+                ++begin;
+            }
+        }
+    }
+
+    // Dense table holding the positions of the tokens of one sentence (the row),
+    // the sentences paired with the row are intersected with it by direct lookups
+    class Row_Probe {
+        std::vector<uint32_t> slot_;        // slot_[id] = position of id in the row + 1, 0 if absent
+        const Sentence_Tokens* row_ = nullptr;
+        size_t row_index_ = 0;
+
+        // Sentences this many times longer than the row are galloped through instead of probed
+        static constexpr size_t GALLOP_RATIO = 16;
+
+    public:
+        // Makes sentence i of the corpus the one others are intersected with
+        void load(const Corpus& corpus, size_t i);
+
+        // Resets the slots of the current row, cost proportional to the row and not to the vocabulary
+        void unload();
+
+        [[nodiscard]] const Sentence_Tokens& row() const { return *row_; }
+
+        [[nodiscard]] size_t row_index() const { return row_index_; }
+
+        // Calls fn(k_row, k_other) for every token shared by the row and other
+        template <typename Fn>
+        void for_each_common(const Sentence_Tokens& other, Fn&& fn) const {
+            if (other.ids.size() > GALLOP_RATIO * row_->ids.size()) {
+                gallop_common(*row_, other, fn);
+                return;
+            }
+            for (size_t k = 0; k < other.ids.size(); k++) {
+                token_id id = other.ids[k];
+                if (id < slot_.size() && slot_[id] != 0) {
+                    fn(static_cast<size_t>(slot_[id] - 1), k);
+                }
+            }
+        }
+    };
+
+    // Similarity policies of TextRank, instantiated into the graph construction so the pair loop has no indirect calls
+    // A policy is constructed once the corpus is complete, operator()(probe, corpus, j) returns the similarity
+    // of the sentence loaded into probe and sentence j
+    // Policies with INCREMENTAL set do not depend on the rest of the corpus, so sentences can be added to the graph
+    // one at a time, preceding(probe, corpus, j) returns the similarity of sentence j, which comes first in the text,
+    // and the sentence loaded into probe, equal to operator() with the roles of the sentences swapped
+
+    // Distinct shared words / (log|S1| + log|S2|), pairs with a zero denominator are not similar
+    struct Overlap {
+        static constexpr bool INCREMENTAL = true;
+
+        explicit Overlap(const Corpus&) {}
+
+        double operator()(const Row_Probe& probe, const Corpus& corpus, size_t j) const {
+            const Sentence_Tokens& other = corpus[j];
+            double bottom = probe.row().log_length + other.log_length;
+            if (!(bottom > 0)) {
+                return 0;
+            }
+            size_t top = 0;
+            probe.for_each_common(other, [&](size_t, size_t) { top++; });
+            return static_cast<double>(top) / bottom;
+        }
+
+        double preceding(const Row_Probe& probe, const Corpus& corpus, size_t j) const {
+            return (*this)(probe, corpus, j);
+        }
+    };
+
+    // The original formula, words of the first sentence are counted as many times as they occur in it
+    // and a zero denominator is divided by as is
+    struct Compat {
+        static constexpr bool INCREMENTAL = true;
+
+        explicit Compat(const Corpus&) {}
+
+        double operator()(const Row_Probe& probe, const Corpus& corpus, size_t j) const {
+            const Sentence_Tokens& row = probe.row();
+            const Sentence_Tokens& other = corpus[j];
+            double top = 0;
+            probe.for_each_common(other, [&](size_t k_row, size_t) { top += row.counts[k_row]; });
+            return top / (row.log_length + other.log_length);
+        }
+
+        // the counts are integers, so the sum is exact in any order and equals operator() of sentence j
+        double preceding(const Row_Probe& probe, const Corpus& corpus, size_t j) const {
+            const Sentence_Tokens& row = probe.row();
+            const Sentence_Tokens& other = corpus[j];
+            double top = 0;
+            probe.for_each_common(other, [&](size_t, size_t k_other) { top += other.counts[k_other]; });
+            return top / (other.log_length + row.log_length);
+        }
+    };
+
+    // Cosine of the TF-IDF vectors of the sentences, suited for texts with a lot of common vocabulary
+    struct Cosine {
+        static constexpr bool INCREMENTAL = false;
+
+        std::vector<double> idf_;           // per token id
+        std::vector<double> norms_;         // per sentence, length of its TF-IDF vector
+
+        explicit Cosine(const Corpus& corpus);
+
+        double operator()(const Row_Probe& probe, const Corpus& corpus, size_t j) const {
+            double bottom = norms_[probe.row_index()] * norms_[j];
+            if (!(bottom > 0)) {
+                return 0;
+            }
+            const Sentence_Tokens& row = probe.row();
+            const Sentence_Tokens& other = corpus[j];
+            double top = 0;
+            probe.for_each_common(other, [&](size_t k_row, size_t k_other) {
+                double idf = idf_[other.ids[k_other]];
+                top += static_cast<double>(row.counts[k_row]) * other.counts[k_other] * idf * idf;
+            });
+            return top / bottom;
+        }
+    };
+
+    // Okapi BM25 averaged over both directions of the pair, suited for texts with sentences of very different lengths
+    struct BM25 {
+        static constexpr bool INCREMENTAL = false;
+        static constexpr double K1 = 1.2;
+        static constexpr double B = 0.75;
+
+        std::vector<double> idf_;           // per token id
+        std::vector<double> length_norm_;   // per sentence, K1 * (1 - B + B * |S| / average |S|)
+
+        explicit BM25(const Corpus& corpus);
+
+        double operator()(const Row_Probe& probe, const Corpus& corpus, size_t j) const {
+            const Sentence_Tokens& row = probe.row();
+            const Sentence_Tokens& other = corpus[j];
+            double norm_row = length_norm_[probe.row_index()];
+            double norm_other = length_norm_[j];
+            double top = 0;
+            probe.for_each_common(other, [&](size_t k_row, size_t k_other) {
+                double tf_row = row.counts[k_row];
+                double tf_other = other.counts[k_other];
+                top += idf_[other.ids[k_other]] * (tf_other * (K1 + 1) / (tf_other + norm_other)
+                                                   + tf_row * (K1 + 1) / (tf_row + norm_row));
+            });
+            return top / 2;
+        }
+    };
+}
+
+#endif //PROJECT_SIMILARITYKERNEL_HPP
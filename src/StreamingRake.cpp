@@ -0,0 +1,194 @@
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef FUNCTIONAL
+#define FUNCTIONAL
+#include <functional>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef SSTREAM
+#define SSTREAM
+#include <sstream>
+#endif
+
+#include "StreamingRake.hpp"
+
+using strVec = std::vector<std::string>;
+using phraseVector = std::vector< strVec >;
+
+Count_Min_Sketch::Count_Min_Sketch(size_t width, size_t depth)
+        : width_(std::max<size_t>(1, width)), depth_(std::max<size_t>(1, depth)), cells_(width_ * depth_) {}
+
+// cell of key in row r, double hashing h1 + r * h2 over one hash of the key
+size_t Count_Min_Sketch::cell(uint64_t hash, size_t r) const {
+    // splitmix64 finalizer, spreads std::hash which may be the identity on some platforms
+    uint64_t h2 = hash + 0x9e3779b97f4a7c15ULL;
+    h2 = (h2 ^ (h2 >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h2 = (h2 ^ (h2 >> 27)) * 0x94d049bb133111ebULL;
+    h2 = (h2 ^ (h2 >> 31)) | 1;
+    return r * width_ + static_cast<size_t>((hash + r * h2) % width_);
+}
+
+void Count_Min_Sketch::add(const std::string& key, double freq, double deg) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    for (size_t r = 0; r < depth_; r++) {
+        Counts& counts = cells_[cell(hash, r)];
+        counts.freq += freq;
+        counts.deg += deg;
+    }
+}
+
+// Smallest counts of the key over all rows, freq and deg are minimized separately
+Count_Min_Sketch::Counts Count_Min_Sketch::estimate(const std::string& key) const {
+    uint64_t hash = std::hash<std::string>{}(key);
+    Counts result = cells_[cell(hash, 0)];
+    for (size_t r = 1; r < depth_; r++) {
+        const Counts& counts = cells_[cell(hash, r)];
+        result.freq = std::min(result.freq, counts.freq);
+        result.deg = std::min(result.deg, counts.deg);
+    }
+    return result;
+}
+
+// Multiplies all counts by factor
+void Count_Min_Sketch::scale(double factor) {
+    for (auto& counts : cells_) {
+        counts.freq *= factor;
+        counts.deg *= factor;
+    }
+}
+
+
+Space_Saving::Space_Saving(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {
+    heap_.reserve(capacity_);
+    position_.reserve(capacity_);
+}
+
+void Space_Saving::swap_entries(size_t i, size_t j) {
+    std::swap(heap_[i], heap_[j]);
+    position_[heap_[i].key] = i;
+    position_[heap_[j].key] = j;
+}
+
+void Space_Saving::sift_down(size_t i) {
+    while (true) {
+        size_t smallest = i;
+        for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < heap_.size(); child++) {
+            if (heap_[child].count < heap_[smallest].count) {
+                smallest = child;
+            }
+        }
+        if (smallest == i) {
+            return;
+        }
+        swap_entries(i, smallest);
+        i = smallest;
+    }
+}
+
+void Space_Saving::add(const std::string& key) {
+    auto it = position_.find(key);
+    if (it != position_.end()) {
+        size_t i = it->second;
+        heap_[i].count++;
+        sift_down(i);
+        return;
+    }
+    if (heap_.size() < capacity_) {
+        heap_.push_back({key, 1, 0});
+        size_t i = heap_.size() - 1;
+        position_[key] = i;
+        // decayed counts may be smaller than 1
+        while (i > 0 && heap_[i].count < heap_[(i - 1) / 2].count) {
+            swap_entries(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+    // replace the phrase with the smallest count
+    position_.erase(heap_[0].key);
+    heap_[0].key = key;
+    heap_[0].error = heap_[0].count;
+    heap_[0].count++;
+    position_[key] = 0;
+    sift_down(0);
+}
+
+// Multiplies all counts by factor, the heap order is unchanged
+void Space_Saving::scale(double factor) {
+    for (auto& entry : heap_) {
+        entry.count *= factor;
+        entry.error *= factor;
+    }
+}
+
+
+// capacity: number of phrases monitored, sketch_width: cells per row of the word sketch
+Streaming_RAKE::Streaming_RAKE(const std::unordered_set<char>& stop_chars, const std::unordered_set<std::string>& stop_words,
+                               size_t capacity, size_t sketch_width)
+        : parser_(stop_chars, stop_words), word_sketch_(sketch_width, SKETCH_DEPTH), phrases_(capacity) {
+    parser_.set_limits(MAX_PHRASE_WORDS, MAX_WORD_LENGTH);
+}
+
+void Streaming_RAKE::on_phrase(strVec&& phrase) {
+    key_.clear();
+    for (const auto& word : phrase) {
+        word_sketch_.add(word, 1, static_cast<double>(phrase.size()));
+        if (!key_.empty()) {
+            key_ += ' ';
+        }
+        key_ += word;
+    }
+    phrases_.add(key_);
+}
+
+// Returns the top len phrases of the stream so far
+phraseVector Streaming_RAKE::get_key_phrases(size_t len) const {
+    std::vector< std::pair<strVec, double> > candidates;
+    for (const auto& entry : phrases_.entries()) {
+        if (entry.count - entry.error < MIN_COUNT) {
+            continue;
+        }
+        std::pair<strVec, double> candidate;
+        std::istringstream words(entry.key);
+        std::string word;
+        while (words >> word) {
+            auto counts = word_sketch_.estimate(word);
+            candidate.second += counts.deg / counts.freq;
+            candidate.first.push_back(std::move(word));
+        }
+        candidates.push_back(std::move(candidate));
+    }
+    // same order as RAKE, decreasing score then lexicographic
+    len = std::min(len, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(len), candidates.end(),
+                      [](const auto& a, const auto& b) {
+                          if (a.second != b.second) {
+                              return a.second > b.second;
+                          }
+                          return a.first < b.first;
+                      });
+    phraseVector result;
+    for (size_t i = 0; i < len; i++) {
+        result.push_back(std::move(candidates[i].first));
+    }
+    return result;
+}
+
+// Multiplies all statistics by factor, older phrases weigh less than recent ones
+void Streaming_RAKE::decay(double factor) {
+    word_sketch_.scale(factor);
+    phrases_.scale(factor);
+}
@@ -0,0 +1,135 @@
+#ifndef PROJECT_STREAMINGRAKE_HPP
+#define PROJECT_STREAMINGRAKE_HPP
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef UNORDERED_SET
+#define UNORDERED_SET
+#include <unordered_set>
+#endif
+
+#ifndef UNORDERED_MAP
+#define UNORDERED_MAP
+#include <unordered_map>
+#endif
+
+#ifndef CSTDINT
+#define CSTDINT
+#include <cstdint>
+#endif
+
+#include "TextPreprocess.hpp"
+
+
+// Count-min sketch of a pair of counters per key, depth rows of width cells
+// Estimates never underestimate, collisions only add counts of other keys
+class Count_Min_Sketch {
+public:
+    struct Counts {
+        double freq = 0;
+        double deg = 0;
+    };
+
+private:
+    size_t width_;
+    size_t depth_;
+    std::vector<Counts> cells_;     // depth_ rows of width_ cells
+
+    // cell of key in row r, double hashing h1 + r * h2 over one hash of the key
+    [[nodiscard]] size_t cell(uint64_t hash, size_t r) const;
+
+public:
+    Count_Min_Sketch(size_t width, size_t depth);
+
+    void add(const std::string& key, double freq, double deg);
+
+    // Smallest counts of the key over all rows, freq and deg are minimized separately
+    [[nodiscard]] Counts estimate(const std::string& key) const;
+
+    // Multiplies all counts by factor
+    void scale(double factor);
+};
+
+
+// Space-Saving heavy hitters over phrases, monitors at most capacity phrases
+// A phrase which is not monitored replaces the one with the smallest count and inherits that count as its error,
+// so count - error is a guaranteed lower bound of the occurrences of the phrase
+class Space_Saving {
+public:
+    struct Entry {
+        std::string key;            // words of the phrase joined by spaces
+        double count = 0;
+        double error = 0;
+    };
+
+private:
+    size_t capacity_;
+    std::vector<Entry> heap_;                               // min-heap by count
+    std::unordered_map<std::string, size_t> position_;      // key -> position in heap_
+
+    void sift_down(size_t i);
+
+    void swap_entries(size_t i, size_t j);
+
+public:
+    explicit Space_Saving(size_t capacity);
+
+    void add(const std::string& key);
+
+    // Multiplies all counts by factor, the heap order is unchanged
+    void scale(double factor);
+
+    [[nodiscard]] const std::vector<Entry>& entries() const { return heap_; }
+};
+
+
+// RAKE over an unbounded stream in constant memory
+// Word frequencies and degrees are kept in a count-min sketch, the most frequent phrases in Space-Saving,
+// the key phrases are the monitored phrases seen at least MIN_COUNT times ranked by their RAKE score
+class Streaming_RAKE {
+    using strVec = std::vector<std::string>;
+    using phraseVector = std::vector< strVec >;
+
+    TextProcess::Phrase_Parser parser_;
+    Count_Min_Sketch word_sketch_;
+    Space_Saving phrases_;
+    std::string key_;               // reused buffer for phrase keys
+
+public:
+    static constexpr size_t MAX_PHRASE_WORDS = 8;
+    static constexpr size_t MAX_WORD_LENGTH = 64;
+    static constexpr size_t SKETCH_DEPTH = 4;
+    static constexpr double MIN_COUNT = 2;
+
+    // capacity: number of phrases monitored, sketch_width: cells per row of the word sketch
+    Streaming_RAKE(const std::unordered_set<char>& stop_chars, const std::unordered_set<std::string>& stop_words,
+                   size_t capacity, size_t sketch_width);
+
+    void feed(char c) { parser_.feed(c, *this); }
+
+    // Ends the stream, counts the phrase in progress
+    void finish() { parser_.finish(*this); }
+
+    // Returns the top len phrases of the stream so far
+    [[nodiscard]] phraseVector get_key_phrases(size_t len) const;
+
+    // Multiplies all statistics by factor, older phrases weigh less than recent ones
+    void decay(double factor);
+
+    // Phrase_Parser consumer
+    void on_phrase(strVec&& phrase);
+
+    void on_stop_word(const std::string&, bool, bool) {}
+
+    void on_stop_char() {}
+};
+
+#endif //PROJECT_STREAMINGRAKE_HPP
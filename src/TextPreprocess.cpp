@@ -23,7 +23,23 @@
 #include <vector>
 #endif
 
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef UNORDERED_MAP
+#define UNORDERED_MAP
+#include <unordered_map>
+#endif
+
+#ifndef CSTDINT
+#define CSTDINT
+#include <cstdint>
+#endif
+
 #include "TextPreprocess.hpp"
+#include "Trace.hpp"
 
 namespace TextProcess {
     // Input: path to file with stop_chars, Output: stop chars loaded into a set
@@ -57,86 +73,224 @@ namespace TextProcess {
     }
 
 
+    // Consumer of Phrase_Parser collecting the phrases
+    struct Phrase_Collector {
+        phraseVector phrases;
+
+        void on_phrase(strVec&& phrase) { phrases.push_back(std::move(phrase)); }
+
+        void on_stop_word(const std::string&, bool, bool) {}
+
+        void on_stop_char() {}
+    };
+
     std::vector<std::vector<std::string>> parse_text_phrases(std::istream& in_stream, const std::unordered_set<char>& stop_chars, const std::unordered_set<std::string>& stop_words) {
-        std::vector<std::vector<std::string>> phrases;
-        std::vector<std::string> phrase;
-        std::string word;
+        TRACE_SCOPE("parse_text_phrases");
+        Phrase_Parser parser(stop_chars, stop_words);
+        Phrase_Collector collector;
         char c;
         while (in_stream.get(c)) {
-            if (!stop_chars.contains(c) && !std::isspace(c)) {
-                word += std::tolower(c);
-                continue;
-            }
-                // c is white space or stop_char
-            else if (word.empty()) {
-                continue;
+            parser.feed(c, collector);
+        }
+        parser.finish(collector);
+        return std::move(collector.phrases);
+    }
+
+    // Consumer of Phrase_Parser collecting the phrases and counting the adjoined ones
+    // Phrases and stop words are interned, so every adjoined occurrence costs one hash lookup of three ids
+    class Adjoined_Counter {
+        struct Key {
+            uint32_t first, stop_word, second;
+
+            bool operator==(const Key& other) const = default;
+        };
+
+        struct Key_Hash {
+            size_t operator()(const Key& key) const {
+                uint64_t h = key.first;
+                h = h * 0x9E3779B97F4A7C15ULL + key.stop_word;
+                h = h * 0x9E3779B97F4A7C15ULL + key.second;
+                return static_cast<size_t>(h ^ (h >> 29));
             }
-                // word is not empty
-            else if (std::isspace(c) and !stop_words.contains(word)) {
-                phrase.push_back(std::move(word));
-                word.clear();
-                continue;
+        };
+
+        std::unordered_map<std::string, uint32_t> phrase_ids_;      // phrase words joined by spaces -> id
+        std::unordered_map<std::string, uint32_t> stop_word_ids_;
+        std::vector<size_t> phrase_first_;                          // id -> index of its first occurrence in phrases
+        std::vector<std::string> stop_words_;                       // id -> stop word
+        std::unordered_map<Key, size_t, Key_Hash> counts_;          // adjoined occurrence -> index in order_
+        std::vector< std::pair<Key, size_t> > order_;               // distinct adjoined phrases with their counts
+
+        // the last phrase and the single stop word after it, while nothing else followed
+        bool pending_ = false;
+        uint32_t pending_phrase_ = 0;
+        uint32_t pending_stop_word_ = 0;
+        uint32_t last_phrase_ = 0;
+
+    public:
+        phraseVector phrases;
+
+        void on_phrase(strVec&& phrase) {
+            std::string joined;
+            for (const auto& word : phrase) {
+                joined += word;
+                joined += ' ';
             }
-                // either c is a stop_char or word is a stop_word
-            else if (stop_words.contains(word)){
-                if (!phrase.empty()){
-                    phrases.push_back(std::move(phrase));
-                    phrase.clear();
-                }
-                word.clear();
-                continue;
+            auto it = phrase_ids_.try_emplace(std::move(joined), static_cast<uint32_t>(phrase_ids_.size())).first;
+            if (it->second == phrase_first_.size()) {
+                phrase_first_.push_back(phrases.size());
             }
-                // c must be a stop_char
-            else if (stop_chars.contains(c)) {
-                phrase.push_back(std::move(word));
-                if (!phrase.empty()){
-                    phrases.push_back(std::move(phrase));
-                    phrase.clear();
+            last_phrase_ = it->second;
+
+            if (pending_) {
+                Key key{pending_phrase_, pending_stop_word_, last_phrase_};
+                auto count = counts_.try_emplace(key, order_.size()).first;
+                if (count->second == order_.size()) {
+                    order_.emplace_back(key, 0);
                 }
-                word.clear();
+                order_[count->second].second++;
             }
+            pending_ = false;
+            phrases.push_back(std::move(phrase));
+        }
 
-            else {
-                throw std::runtime_error("Unexpected situation during parsing text into phrases occured!");
+        void on_stop_word(const std::string& word, bool ended_phrase, bool at_stop_char) {
+            pending_ = ended_phrase && !at_stop_char;
+            if (pending_) {
+                auto it = stop_word_ids_.try_emplace(word, static_cast<uint32_t>(stop_word_ids_.size())).first;
+                if (it->second == stop_words_.size()) {
+                    stop_words_.push_back(word);
+                }
+                pending_phrase_ = last_phrase_;
+                pending_stop_word_ = it->second;
             }
         }
 
-        if (!word.empty() && !stop_words.contains(word)) {
-            phrase.push_back(std::move(word));
+        void on_stop_char() { pending_ = false; }
+
+        // Every distinct adjoined phrase with its count, in order of first occurrence
+        std::vector< std::pair<strVec, size_t> > adjoined() const {
+            std::vector< std::pair<strVec, size_t> > result;
+            result.reserve(order_.size());
+            for (const auto& key_count : order_) {
+                const Key& key = key_count.first;
+                strVec phrase = phrases[phrase_first_[key.first]];
+                phrase.push_back(stop_words_[key.stop_word]);
+                const strVec& second = phrases[phrase_first_[key.second]];
+                phrase.insert(phrase.end(), second.begin(), second.end());
+                result.emplace_back(std::move(phrase), key_count.second);
+            }
+            return result;
         }
+    };
 
-        if (!phrase.empty()) {
-            phrases.push_back(std::move(phrase));
+    // parse_text_phrases which also counts the adjoined phrases, two phrases separated by a single stop word
+    // (e.g. "axis of evil"), in the same pass. adjoined receives every distinct adjoined phrase with its count
+    // in order of first occurrence, the stop word included
+    phraseVector parse_text_phrases_adjoined(std::istream& in_stream, const std::unordered_set<char>& stop_chars,
+                                             const std::unordered_set<std::string>& stop_words,
+                                             std::vector< std::pair<strVec, size_t> >& adjoined) {
+        TRACE_SCOPE("parse_text_phrases_adjoined");
+        Phrase_Parser parser(stop_chars, stop_words);
+        Adjoined_Counter counter;
+        char c;
+        while (in_stream.get(c)) {
+            parser.feed(c, counter);
         }
-        return phrases;
+        parser.finish(counter);
+        adjoined = counter.adjoined();
+        return std::move(counter.phrases);
     }
 
     // Function that splits a text into sentences
     std::vector<std::string> parse_text_sentences(std::istream& in_stream, const std::unordered_set<char>& sent_end_chars) {
-        std::vector<std::string> sentences;
-        std::string sentence;
+        TRACE_SCOPE("parse_text_sentences");
+        struct Sentence_Collector {
+            std::vector<std::string> sentences;
+
+            void on_sentence(std::string&& sentence) {
+                sentences.push_back(std::move(sentence));
+            }
+        } collector;
+        Sentence_Parser parser(sent_end_chars);
         char c;
         while (in_stream.get(c)) {
-            if (c == '\0') {
-                continue;
+            parser.feed(c, collector);
+        }
+        parser.finish(collector);
+        return std::move(collector.sentences);
+    }
+
+    // Splits a text into sentences like parse_text_sentences and groups them into sections
+    // Unlike parse_text_sentences, blank lines and headings end the current sentence in modes other than FIXED
+    Sectioned_Text parse_text_sections(std::istream& in_stream, const std::unordered_set<char>& sent_end_chars,
+                                       Section_Mode mode, size_t section_size) {
+        TRACE_SCOPE("parse_text_sections");
+        if (section_size == 0) {
+            throw std::runtime_error("Error: Section size must be positive!");
+        }
+        Sectioned_Text text;
+        text.section_starts.push_back(0);
+        std::string sentence;
+        bool new_section = false;   // the next sentence starts a section
+
+        auto blank = [](const std::string& str) {
+            return std::all_of(str.begin(), str.end(), [](char c) { return std::isspace(c); });
+        };
+        auto section_length = [&]() {
+            return text.sentences.size() - text.section_starts.back();
+        };
+        auto push_sentence = [&]() {
+            if (!sentence.empty() && sentence != " " && (mode == FIXED || !blank(sentence))) {
+                if (new_section && !text.sentences.empty()) {
+                    text.section_starts.push_back(text.sentences.size());
+                }
+                new_section = false;
+                text.sentences.push_back(sentence);
+                if ((mode == FIXED && text.sentences.size() % section_size == 0) ||
+                    section_length() >= MAX_SECTION_FACTOR * section_size) {
+                    new_section = true;
+                }
             }
-            if ((std::isspace(c))) {
-                sentence.push_back(' ');
+            sentence.clear();
+        };
+
+        std::string line;
+        while (std::getline(in_stream, line)) {
+            if (mode != FIXED && blank(line)) {
+                push_sentence();
+                if ((mode == BLANK_LINES && section_length() >= section_size) ||
+                    (mode == HEADINGS && section_length() >= 4 * section_size)) {
+                    new_section = true;
+                }
                 continue;
             }
-            sentence.push_back(c);
-            if (sent_end_chars.contains(c) && !sentence.empty() && sentence != " ") {
-                sentences.push_back(sentence);
-                sentence.clear();
+            if (mode == HEADINGS && std::any_of(line.begin(), line.end(), [](char c) { return std::isalpha(c); }) &&
+                std::none_of(line.begin(), line.end(), [](char c) { return std::islower(c); })) {
+                push_sentence();
+                new_section = true;
+                continue;   // headings are titles, not sentences of the text
             }
-            else{
-                continue;
+
+            for (char c : line) {
+                if (c == '\0') {
+                    continue;
+                }
+                if (std::isspace(c)) {
+                    sentence.push_back(' ');
+                    continue;
+                }
+                sentence.push_back(c);
+                if (sent_end_chars.contains(c)) {
+                    push_sentence();
+                }
+            }
+            if (!in_stream.eof()) {     // getline consumed a new line character
+                sentence.push_back(' ');
             }
         }
-        if (!sentence.empty() && sentence != " ") {
-            sentences.push_back(sentence);
-        }
-        return sentences;
+        push_sentence();
+        return text;
     }
 
     // split a string (sentence) into a vector of words, removing stop_chars, stop_words
@@ -169,6 +323,7 @@ namespace TextProcess {
     // split each sentence into a vector of words, remove stop_words, stop_chars
     phraseVector process_sentences(const strVec& sentences, const std::unordered_set<char>& stop_chars,
                                    const std::unordered_set<std::string>& stop_words) {
+        TRACE_SCOPE("process_sentences");
         phraseVector result;
         for (auto& sent_in : sentences) {
             result.push_back(process_sentence(sent_in, stop_chars, stop_words));
@@ -177,17 +332,10 @@ namespace TextProcess {
     }
 
     void output_to_stream(std::ostream& out_stream, const std::vector< std::vector<std::string> >& str_matrix) {
-        for (const auto& phrase: str_matrix) {
-            for (const auto& word: phrase) {
-                out_stream << word << " ";
-            }
-            out_stream << std::endl;
-        }
+        output_range(out_stream, str_matrix);
     }
 
     void output_to_stream(std::ostream& out_stream, const std::vector< std::string>& str_vec) {
-        for (const auto& str: str_vec) {
-            out_stream << str << std::endl;
-        }
+        output_range(out_stream, str_vec);
     }
-}
\ No newline at end of file
+}
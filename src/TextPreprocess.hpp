@@ -26,7 +26,28 @@
 #include <vector>
 #endif
 
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef CCTYPE
+#define CCTYPE
+#include <cctype>
+#endif
+
+#ifndef RANGES
+#define RANGES
+#include <ranges>
+#endif
+
+#ifndef TYPE_TRAITS
+#define TYPE_TRAITS
+#include <type_traits>
+#endif
+
 #include "FileProcess.hpp"
+#include "Trace.hpp"
 
 namespace TextProcess {
     using strVec = std::vector<std::string>;
@@ -38,11 +59,165 @@ namespace TextProcess {
     // Input: path to file with stop_words, Output: stop words loaded into a set
     std::unordered_set<std::string> load_stop_words(const std::string& words_file_path);
 
+    // Incremental state machine splitting a text into phrases at stop words and stop chars, fed one character at a time
+    // Events are reported to a consumer with the methods
+    //     on_phrase(strVec&& phrase)                              a phrase ended
+    //     on_stop_word(const std::string& word, bool ended_phrase, bool at_stop_char)
+    //                                                             a stop word ended, right after the phrase it ended if any
+    //     on_stop_char()                                          a stop char separated two words
+    class Phrase_Parser {
+        const std::unordered_set<char>& stop_chars_;
+        const std::unordered_set<std::string>& stop_words_;
+        strVec phrase_;
+        std::string word_;
+        size_t max_phrase_words_ = 0;       // 0 = unlimited
+        size_t max_word_length_ = 0;        // 0 = unlimited
+
+    public:
+        Phrase_Parser(const std::unordered_set<char>& stop_chars, const std::unordered_set<std::string>& stop_words)
+                : stop_chars_(stop_chars), stop_words_(stop_words) {}
+
+        // Bounds the memory of the parser on unbounded input, characters past max_word_length are dropped
+        // from a word and words past max_phrase_words from a phrase, 0 = unlimited
+        void set_limits(size_t max_phrase_words, size_t max_word_length) {
+            max_phrase_words_ = max_phrase_words;
+            max_word_length_ = max_word_length;
+        }
+
+        template <typename Consumer>
+        void feed(char c, Consumer& consumer) {
+            if (!stop_chars_.contains(c) && !std::isspace(c)) {
+                if (max_word_length_ == 0 || word_.size() < max_word_length_) {
+                    word_ += static_cast<char>(std::tolower(c));
+                }
+                return;
+            }
+            // c is white space or stop_char
+            if (word_.empty()) {
+                if (stop_chars_.contains(c)) {
+                    consumer.on_stop_char();
+                }
+                return;
+            }
+            // word is not empty
+            if (std::isspace(c) && !stop_words_.contains(word_)) {
+                push_word();
+                return;
+            }
+            // either c is a stop_char or word is a stop_word
+            if (stop_words_.contains(word_)) {
+                bool ended_phrase = !phrase_.empty();
+                emit(consumer);
+                consumer.on_stop_word(word_, ended_phrase, !std::isspace(c));
+                word_.clear();
+                return;
+            }
+            // c must be a stop_char
+            push_word();
+            emit(consumer);
+            consumer.on_stop_char();
+        }
+
+        // Ends the text, reports the last phrase
+        template <typename Consumer>
+        void finish(Consumer& consumer) {
+            if (!word_.empty() && !stop_words_.contains(word_)) {
+                push_word();
+            }
+            word_.clear();
+            emit(consumer);
+        }
+
+    private:
+        void push_word() {
+            if (max_phrase_words_ == 0 || phrase_.size() < max_phrase_words_) {
+                phrase_.push_back(std::move(word_));
+            }
+            word_.clear();
+        }
+
+        template <typename Consumer>
+        void emit(Consumer& consumer) {
+            if (!phrase_.empty()) {
+                consumer.on_phrase(std::move(phrase_));
+                phrase_.clear();
+            }
+        }
+    };
+
     std::vector<std::vector<std::string>> parse_text_phrases(std::istream& in_stream, const std::unordered_set<char>& stop_chars, const std::unordered_set<std::string>& stop_words);
 
+    // parse_text_phrases which also counts the adjoined phrases, two phrases separated by a single stop word
+    // (e.g. "axis of evil"), in the same pass. adjoined receives every distinct adjoined phrase with its count
+    // in order of first occurrence, the stop word included
+    phraseVector parse_text_phrases_adjoined(std::istream& in_stream, const std::unordered_set<char>& stop_chars,
+                                             const std::unordered_set<std::string>& stop_words,
+                                             std::vector< std::pair<strVec, size_t> >& adjoined);
+
+    // Incremental state machine splitting a text into sentences, fed one character at a time
+    // White space is replaced by spaces, sentences end after a sentence end char and are reported to a consumer
+    // with the method on_sentence(std::string&& sentence)
+    class Sentence_Parser {
+        const std::unordered_set<char>& sent_end_chars_;
+        std::string sentence_;
+
+    public:
+        explicit Sentence_Parser(const std::unordered_set<char>& sent_end_chars) : sent_end_chars_(sent_end_chars) {}
+
+        template <typename Consumer>
+        void feed(char c, Consumer& consumer) {
+            if (c == '\0') {
+                return;
+            }
+            if (std::isspace(c)) {
+                sentence_.push_back(' ');
+                return;
+            }
+            sentence_.push_back(c);
+            if (sent_end_chars_.contains(c)) {
+                emit(consumer);
+            }
+        }
+
+        // Ends the text, reports the last sentence
+        template <typename Consumer>
+        void finish(Consumer& consumer) {
+            emit(consumer);
+        }
+
+    private:
+        template <typename Consumer>
+        void emit(Consumer& consumer) {
+            if (!sentence_.empty() && sentence_ != " ") {
+                consumer.on_sentence(std::move(sentence_));
+            }
+            sentence_.clear();
+        }
+    };
+
     // Function that splits a text into sentences
     std::vector<std::string> parse_text_sentences(std::istream& in_stream, const std::unordered_set<char>& sent_end_chars);
 
+    // How parse_text_sections splits a text into sections
+    // BLANK_LINES: runs of paragraphs (separated by blank lines) with at least section_size sentences
+    // HEADINGS: a line with letters but no lowercase letters (e.g. "CHAPTER IV") starts a new section and is left out,
+    //           sections longer than 4 * section_size are split at the next blank line
+    // FIXED: section_size consecutive sentences
+    // In every mode a section is cut after MAX_SECTION_FACTOR * section_size sentences, even without a blank line
+    enum Section_Mode {BLANK_LINES, HEADINGS, FIXED};
+    constexpr size_t MAX_SECTION_FACTOR = 8;
+
+    // Sentences of a text and the indices of the sentences starting a section, section_starts[0] == 0
+    struct Sectioned_Text {
+        strVec sentences;
+        std::vector<size_t> section_starts;
+    };
+
+    // Splits a text into sentences like parse_text_sentences and groups them into sections
+    // Unlike parse_text_sentences, blank lines and headings end the current sentence in modes other than FIXED
+    Sectioned_Text parse_text_sections(std::istream& in_stream, const std::unordered_set<char>& sent_end_chars,
+                                       Section_Mode mode, size_t section_size);
+
     // split a string (sentence) into a vector of words, removing stop_chars, stop_words
     strVec process_sentence(const std::string& sentence_in, const std::unordered_set<char>& stop_chars,
                            const std::unordered_set<std::string>& stop_words);
@@ -51,6 +226,24 @@ namespace TextProcess {
     phraseVector process_sentences(const strVec& sentences, const std::unordered_set<char>& stop_chars,
                                    const std::unordered_set<std::string>& stop_words);
 
+    // Writes a range of sentences, one per line, or of phrases, words followed by a space and one phrase per line,
+    // element by element, so lazy views are written without being materialized
+    template <std::ranges::input_range Range>
+    void output_range(std::ostream& out_stream, Range&& range) {
+        TRACE_SCOPE("output");
+        for (const auto& element : range) {
+            if constexpr (std::is_convertible_v<decltype(element), const std::string&>) {
+                out_stream << element << std::endl;
+            }
+            else {
+                for (const auto& word : element) {
+                    out_stream << word << " ";
+                }
+                out_stream << std::endl;
+            }
+        }
+    }
+
     void output_to_stream(std::ostream& out_stream, const std::vector< std::vector<std::string> >& str_matrix);
 
     void output_to_stream(std::ostream& out_stream, const std::vector< std::string>& str_vec);
@@ -24,24 +24,38 @@
 #endif
 
 #include "TextRank.hpp"
+#include "Trace.hpp"
 
 using strVec = std::vector<std::string>;
 using phraseVector = std::vector< strVec >;
 
 
 // Returns summary of length calculated by percentage of the overall length of the text
-strVec TextRank::get_summary(double percent) {
-    if (percent < 0 || percent > 1) {
-        throw std::runtime_error("Error: Percentage of sentences included in the summary should be between 0 and 1!");
-    }
-    size_t len = graph_.size() * percent;
-    return get_summary_priv(len);
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+strVec TextRank<SimilarityPolicy, NormalizationPolicy>::get_summary(double percent) {
+    return get_summary_priv(summary_length(percent));
 }
 
 // Returns summary with specified number of sentences
 // Get the parameter as int in case the user inputs a negative number
 // Converts it to size_t after necessary checks
-strVec TextRank::get_summary(int len_i) {
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+strVec TextRank<SimilarityPolicy, NormalizationPolicy>::get_summary(int len_i) {
+    return get_summary_priv(summary_length(len_i));
+}
+
+// Number of sentences of a summary given by a percentage of the text, throws if the percentage is not in [0, 1]
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+size_t TextRank<SimilarityPolicy, NormalizationPolicy>::summary_length(double percent) const {
+    if (percent < 0 || percent > 1) {
+        throw std::runtime_error("Error: Percentage of sentences included in the summary should be between 0 and 1!");
+    }
+    return static_cast<size_t>(static_cast<double>(sentences_.size()) * percent);
+}
+
+// Number of sentences of a summary given by the user, throws if negative and warns if longer than the text
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+size_t TextRank<SimilarityPolicy, NormalizationPolicy>::summary_length(int len_i) const {
     if (len_i < 0) {
         throw std::runtime_error("Error: Length of summary cannot be negative!");
     }
@@ -49,30 +63,51 @@ strVec TextRank::get_summary(int len_i) {
     if (len > sentences_.size()) {
         std::cerr << "Warning: Length of summary requested is longer than the text." << std::endl;
     }
-    len = std::min(len, sentences_.size());
-    return get_summary_priv(len);
+    return std::min(len, sentences_.size());
 }
 
-// Equality for doubles, epsilon defines precision required
-bool TextRank::doublesEqual(double a, double b, double epsilon) {
-    return std::abs(a - b) < epsilon;
+// Sets the number of threads used by the iteration, 1 runs the sequential in-place update
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::set_threads(size_t num_threads) {
+    if (num_threads == 0) {
+        throw std::runtime_error("Error: Number of threads must be positive!");
+    }
+    num_threads_ = num_threads;
 }
 
-// Calculates the similarity between 2 sentences
-double TextRank::similarity(TextRank::strVec &sent_1, TextRank::strVec &sent_2) {
-    double top = 0;
-    for (auto& word : sent_1) {
-        if (std::find(sent_2.begin(), sent_2.end(), word) != sent_2.end()) {
-            top += 1;
-        }
+// Weights of the sentences, indexed by their position in the text, a sentence of weight w gets w times
+// the score (1 - d) every node receives from the random jump, e.g. for a sentence standing for repeated copies
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::set_node_weights(const std::vector<double>& weights) {
+    if (calculated) {
+        throw std::runtime_error("Error: Node weights of TextRank have to be set before ranking!");
+    }
+    if (weights.size() != sentences_.size()) {
+        throw std::runtime_error("Error: TextRank needs one node weight per sentence!");
+    }
+    finish_graph();
+    for (TextRank_Node& node : graph_) {
+        node.weight = weights[node.sent_index];
     }
-    double bottom = log(sent_1.size()) + log(sent_2.size());
-    return top / bottom;
+}
+
+// With lazy convergence get_summary stops iterating as soon as the set of sentences in the summary is settled
+// instead of waiting for all the scores to converge, get_scores always runs until full convergence
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::set_lazy_convergence(bool lazy) {
+    lazy_convergence_ = lazy;
+}
+
+// Equality for doubles, epsilon defines precision required
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+bool TextRank<SimilarityPolicy, NormalizationPolicy>::doublesEqual(double a, double b, double epsilon) {
+    return std::abs(a - b) < epsilon;
 }
 
 // Calculates the normalization constants for each node
 // Normalization Constant = Sum of the weights of all outgoing edges
-void TextRank::set_norm_constants() {
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::set_norm_constants() {
     for (TextRank_Node& node: graph_) {
         double sum = 0;
         for (auto& edge_pair : node.edges) {
@@ -82,7 +117,9 @@ void TextRank::set_norm_constants() {
     }
 }
 
-void TextRank::construct_graph() {
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::construct_graph() {
+    TRACE_SCOPE("construct_graph");
     size_t size = tokenized_sentences_.size();
     graph_.reserve(size);
     double init_score = static_cast<double>(1) / static_cast<double>(size);
@@ -93,41 +130,251 @@ void TextRank::construct_graph() {
         graph_[i].score = init_score;
     }
 
+    for (const auto& sentence : tokenized_sentences_) {
+        corpus_.add_sentence(sentence);
+    }
+
+    // sentence i is loaded into the probe once and intersected with every later sentence
+    SimilarityPolicy similarity(corpus_);
+    if (limits_.max_edges > 0 || limits_.max_postings > 0) {
+        construct_limited_graph(similarity);
+        set_norm_constants();
+        graph_complete_ = true;
+        return;
+    }
+    Similarity::Row_Probe probe;
     for (size_t i = 0; i < size; i++) {
+        probe.load(corpus_, i);
         for (size_t j = i + 1; j < size; j++) {
-            double sim_i_j = similarity(tokenized_sentences_[i], tokenized_sentences_[j]);
+            double sim_i_j = similarity(probe, corpus_, j);
             if (!doublesEqual(sim_i_j, 0)) {
                 graph_[i].edges.emplace_back(j, sim_i_j);
                 graph_[j].edges.emplace_back(i, sim_i_j);
             }
         }
+        probe.unload();
     }
     set_norm_constants();
+    graph_complete_ = true;
+}
+
+// Edges of a graph with limits_, every sentence keeps the limits_.max_edges best of its candidate pairs,
+// an edge is kept if it is among the best of either of its sentences
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::construct_limited_graph(const SimilarityPolicy& similarity) {
+    TRACE_SCOPE("construct_limited_graph");
+    size_t size = graph_.size();
+    using Candidate = std::pair<double, size_t>;    // weight, other sentence
+    // min-heaps of the best edges of every sentence, the weakest on top, ties keep the earlier sentence
+    auto weaker = [](const Candidate& a, const Candidate& b) {
+        if (a.first != b.first) {
+            return a.first > b.first;
+        }
+        return a.second < b.second;
+    };
+    std::vector< std::vector<Candidate> > best(limits_.max_edges > 0 ? size : 0);
+    auto offer = [&](size_t i, size_t j, double w) {
+        std::vector<Candidate>& heap = best[i];
+        if (heap.size() < limits_.max_edges) {
+            heap.emplace_back(w, j);
+            std::push_heap(heap.begin(), heap.end(), weaker);
+        }
+        else if (weaker(Candidate(w, j), heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), weaker);
+            heap.back() = Candidate(w, j);
+            std::push_heap(heap.begin(), heap.end(), weaker);
+        }
+    };
+
+    // sentences containing each word, words in more than max_postings sentences are left out
+    std::vector< std::vector<size_t> > postings;
+    if (limits_.max_postings > 0) {
+        postings.resize(corpus_.vocabulary_size());
+        for (size_t i = 0; i < size; i++) {
+            for (Similarity::token_id id : corpus_[i].ids) {
+                if (corpus_.doc_freq(id) <= limits_.max_postings) {
+                    postings[id].push_back(i);
+                }
+            }
+        }
+    }
+
+    Similarity::Row_Probe probe;
+    std::vector<size_t> candidates;
+    std::vector<size_t> seen(size, size);   // seen[j] == i if j is already a candidate of i
+    for (size_t i = 0; i < size; i++) {
+        candidates.clear();
+        if (limits_.max_postings > 0) {
+            for (Similarity::token_id id : corpus_[i].ids) {
+                // postings are in increasing order, only later sentences are paired with i
+                auto later = std::upper_bound(postings[id].begin(), postings[id].end(), i);
+                for (auto it = later; it != postings[id].end(); ++it) {
+                    if (seen[*it] != i) {
+                        seen[*it] = i;
+                        candidates.push_back(*it);
+                    }
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+        }
+        else {
+            for (size_t j = i + 1; j < size; j++) {
+                candidates.push_back(j);
+            }
+        }
+
+        probe.load(corpus_, i);
+        for (size_t j : candidates) {
+            double sim_i_j = similarity(probe, corpus_, j);
+            if (std::isnan(sim_i_j) || doublesEqual(sim_i_j, 0)) {
+                continue;
+            }
+            if (limits_.max_edges == 0) {
+                graph_[i].edges.emplace_back(j, sim_i_j);
+                graph_[j].edges.emplace_back(i, sim_i_j);
+            }
+            else {
+                offer(i, j, sim_i_j);
+                offer(j, i, sim_i_j);
+            }
+        }
+        probe.unload();
+    }
+    if (limits_.max_edges == 0) {
+        return;
+    }
+
+    // union of the kept edges, every edge once with the smaller sentence first
+    std::vector< std::pair< std::pair<size_t, size_t>, double > > kept;
+    for (size_t i = 0; i < size; i++) {
+        for (const Candidate& candidate : best[i]) {
+            kept.push_back({{std::min(i, candidate.second), std::max(i, candidate.second)}, candidate.first});
+        }
+        std::vector<Candidate>().swap(best[i]);
+    }
+    std::sort(kept.begin(), kept.end());
+    kept.erase(std::unique(kept.begin(), kept.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+               kept.end());
+    for (const auto& edge : kept) {
+        graph_[edge.first.first].edges.emplace_back(edge.first.second, edge.second);
+        graph_[edge.first.second].edges.emplace_back(edge.first.first, edge.second);
+    }
+}
+
+// Appends the next sentence of the text, only before the first ranking
+// With an INCREMENTAL similarity policy its edges are inserted right away, so the graph is built while
+// the text is still being read, other policies need the whole corpus and build the graph at the first ranking
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::add_sentence(std::string sentence, strVec tokenized_sentence) {
+    if (graph_complete_) {
+        throw std::runtime_error("Error: Sentences cannot be added to TextRank after ranking!");
+    }
+    sentences_.push_back(std::move(sentence));
+    if constexpr (!SimilarityPolicy::INCREMENTAL) {
+        tokenized_sentences_.push_back(std::move(tokenized_sentence));
+    }
+    else {
+        TRACE_SCOPE("add_sentence");
+        size_t n = corpus_.add_sentence(tokenized_sentence);
+        graph_.emplace_back();
+        graph_[n].sent_index = n;
+        graph_[n].norm_constant = 1;
+
+        // edges are appended in the same order as construct_graph appends them, so the iterations sum identically
+        SimilarityPolicy similarity(corpus_);
+        probe_.load(corpus_, n);
+        for (size_t j = 0; j < n; j++) {
+            double sim_j_n = similarity.preceding(probe_, corpus_, j);
+            if (!doublesEqual(sim_j_n, 0)) {
+                graph_[n].edges.emplace_back(j, sim_j_n);
+                graph_[j].edges.emplace_back(n, sim_j_n);
+            }
+        }
+        probe_.unload();
+    }
+}
+
+// Completes a graph filled with add_sentence
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::finish_graph() {
+    if (graph_complete_) {
+        return;
+    }
+    if constexpr (!SimilarityPolicy::INCREMENTAL) {
+        construct_graph();
+    }
+    else {
+        double init_score = static_cast<double>(1) / static_cast<double>(graph_.size());
+        for (TextRank_Node& node : graph_) {
+            node.score = init_score;
+        }
+        set_norm_constants();
+        graph_complete_ = true;
+    }
 }
 
 // A single iteration of the algorithm that incrementally updates node scores
 // Returns the total change in scores during this iteration
-double TextRank::iteration(double d) {
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+double TextRank<SimilarityPolicy, NormalizationPolicy>::iteration(double d) {
+    TRACE_SCOPE("iteration");
     double change = 0;
     for (TextRank_Node& node : graph_) {
         double old_score = node.score;
         double new_score = 0;
         for (const auto& edge_pair : node.edges) {
             size_t edge_from = edge_pair.first;
-            double w = edge_pair.second / graph_[edge_from].norm_constant;
+            double w = NormalizationPolicy::weight(edge_pair.second, graph_[edge_from].norm_constant, node.norm_constant);
             new_score += w * graph_[edge_from].score;
         }
         new_score *= d;
-        new_score += 1 - d;
+        new_score += (1 - d) * node.weight;
         node.score = new_score;
         change += std::abs(new_score - old_score);
     }
     return change;
 }
 
+// Multithreaded Jacobi variant of iteration, node ranges are updated concurrently by team from the previous scores
+// The change is summed in node order, so results are the same for any number of threads above 1
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+double TextRank<SimilarityPolicy, NormalizationPolicy>::iteration_parallel(double d, Parallel::Thread_Team& team) {
+    TRACE_SCOPE("iteration");
+    size_t size = graph_.size();
+    size_t block_size = std::max(MIN_ITERATION_BLOCK, (size + team.size() * BLOCKS_PER_THREAD - 1) / (team.size() * BLOCKS_PER_THREAD));
+    size_t num_blocks = (size + block_size - 1) / block_size;
+    next_scores_.resize(size);
+
+    team.for_each_block(num_blocks, [&](size_t block) {
+        TRACE_SCOPE("iteration_block");
+        size_t begin = block * block_size;
+        size_t end = std::min(begin + block_size, size);
+        for (size_t i = begin; i < end; i++) {
+            double new_score = 0;
+            for (const auto& edge_pair : graph_[i].edges) {
+                size_t edge_from = edge_pair.first;
+                double w = NormalizationPolicy::weight(edge_pair.second, graph_[edge_from].norm_constant,
+                                                   graph_[i].norm_constant);
+                new_score += w * graph_[edge_from].score;
+            }
+            new_score *= d;
+            new_score += (1 - d) * graph_[i].weight;
+            next_scores_[i] = new_score;
+        }
+    });
+
+    double change = 0;
+    for (size_t i = 0; i < size; i++) {     // fixed reduction order, independent of the blocks
+        change += std::abs(next_scores_[i] - graph_[i].score);
+        graph_[i].score = next_scores_[i];
+    }
+    return change;
+}
+
 // Comparison function for Nodes to be used by std::set and std::sort
 // First compares scores, then indices
-bool TextRank::custom_comp(const TextRank_Node &a, const TextRank_Node &b) {
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+bool TextRank<SimilarityPolicy, NormalizationPolicy>::custom_comp(const TextRank_Node &a, const TextRank_Node &b) {
     if (a.score != b.score) {
         return a.score > b.score;
     }
@@ -135,34 +382,142 @@ bool TextRank::custom_comp(const TextRank_Node &a, const TextRank_Node &b) {
 }
 
 // Iterates until scores reach equilibrium
-void TextRank::iterate() {
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::iterate() {
+    Parallel::Thread_Team team(num_threads_);   // started once, reused by every iteration
     double change = std::numeric_limits<double>::max();
     while (change > 0.001) {
-        change = iteration(0.85);
+        change = num_threads_ > 1 ? iteration_parallel(DAMPING, team) : iteration(DAMPING);
     }
 }
 
-// Returns summary of specified number of sentences
-strVec TextRank::get_summary_priv(size_t len) {
-    if (!calculated){
+// Iterates until the membership of the top k sentences is settled
+// Stops once it was stable for STABLE_ITERATIONS iterations and the gap between the k-th and the (k+1)-th score
+// exceeds twice the bound on how much any score can still move, or when the scores reach equilibrium
+// The bound holds for Jacobi iterations of a CONTRACTIVE normalization, others iterate to full convergence
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::iterate_top_k(size_t k) {
+    if constexpr (!NormalizationPolicy::CONTRACTIVE) {
         iterate();
-        std::sort(graph_.begin(), graph_.end(), custom_comp);   // sort graph_ by scores
-        calculated = true;
+        return;
     }
+    if (k == 0 || k >= graph_.size()) {    // membership is trivial
+        return;
+    }
+    std::vector<size_t> previous;
+    size_t stable = 0;
+    Parallel::Thread_Team team(num_threads_);   // started once, reused by every iteration
+    double change = std::numeric_limits<double>::max();
+    while (change > 0.001) {
+        // Jacobi also on a single thread, the in-place update does not shrink the change by a known factor
+        change = iteration_parallel(DAMPING, team);
+
+        double gap;
+        std::vector<size_t> current = top_k_members(k, gap);
+        stable = (current == previous) ? stable + 1 : 0;
+        previous = std::move(current);
+
+        // every later iteration changes the scores by at most DAMPING times the previous one, so no score
+        // moves by more than the sum of the remaining geometric series
+        double bound = change * DAMPING / (1 - DAMPING);
+        if (stable >= STABLE_ITERATIONS && gap > 2 * bound) {
+            return;
+        }
+    }
+}
 
-    std::vector<size_t> summary_sents_i;    // sentence indices
-    summary_sents_i.reserve(len);
-    for (size_t i = 0; i < len; i++) {      // store indices of sentences that should be in the summary
-        summary_sents_i.push_back(graph_[i].sent_index);
+// Returns the indices of the k best nodes (sorted) and sets gap to the score difference at the boundary
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+std::vector<size_t> TextRank<SimilarityPolicy, NormalizationPolicy>::top_k_members(size_t k, double& gap) const {
+    std::vector<size_t> order(graph_.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
     }
-    // sort the indices so that sentences in the summary appear in order
-    std::sort(summary_sents_i.begin(), summary_sents_i.end());
+    auto better = [&](size_t a, size_t b) { return custom_comp(graph_[a], graph_[b]); };
+    std::nth_element(order.begin(), order.begin() + k, order.end(), better);
+    double kth = graph_[*std::max_element(order.begin(), order.begin() + k, better)].score;
+    gap = kth - graph_[order[k]].score;
+    order.resize(k);
+    std::sort(order.begin(), order.end());
+    return order;
+}
 
+// Returns the final score of every sentence, indexed by the position of the sentence in the text
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+std::vector<double> TextRank<SimilarityPolicy, NormalizationPolicy>::get_scores() {
+    calculate();
+    std::vector<double> scores(graph_.size());
+    for (const TextRank_Node& node : graph_) {
+        scores[node.sent_index] = node.score;
+    }
+    return scores;
+}
+
+// Returns the positions in the text of the len best sentences (at most all of them), from the best one
+// With lazy convergence only the membership of the len best is settled, not their order
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+std::vector<size_t> TextRank<SimilarityPolicy, NormalizationPolicy>::get_ranking(size_t len) {
+    len = std::min(len, sentences_.size());
+    calculate(len);
+    std::vector<size_t> ranking;
+    ranking.reserve(len);
+    for (size_t i = 0; i < len; i++) {
+        ranking.push_back(graph_[i].sent_index);
+    }
+    return ranking;
+}
+
+// Runs the iterations until the top_k best sentences are known and sorts graph_ by scores
+// Does nothing if the current scores are already good enough
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+void TextRank<SimilarityPolicy, NormalizationPolicy>::calculate(size_t top_k) {
+    finish_graph();
+    if (!lazy_convergence_) {
+        top_k = FULL;
+    }
+    if (calculated && (converged_top_k_ == FULL || converged_top_k_ == top_k)) {
+        return;
+    }
+    if (calculated) {
+        // the iterations address nodes by position, restore the original order
+        std::sort(graph_.begin(), graph_.end(), [](const TextRank_Node& a, const TextRank_Node& b) {
+            return a.sent_index < b.sent_index;
+        });
+    }
+
+    if (top_k == FULL) {
+        iterate();
+    }
+    else {
+        iterate_top_k(top_k);
+    }
+    converged_top_k_ = top_k;
+    TRACE_SCOPE("sort_scores");
+    std::sort(graph_.begin(), graph_.end(), custom_comp);   // sort graph_ by scores
+    rank_of_.resize(graph_.size());
+    for (size_t i = 0; i < graph_.size(); i++) {
+        rank_of_[graph_[i].sent_index] = i;
+    }
+    calculated = true;
+}
+
+// Returns summary of specified number of sentences
+template <typename SimilarityPolicy, typename NormalizationPolicy>
+strVec TextRank<SimilarityPolicy, NormalizationPolicy>::get_summary_priv(size_t len) {
+    // the iterator of the view is not a legacy input iterator in strict C++20, so no range constructor
     strVec summary;
-    summary.reserve(len);
-    for (auto i: summary_sents_i) {
-        summary.push_back(sentences_[i]);
+    for (const std::string& sentence : summary_view_priv(len)) {
+        summary.push_back(sentence);
     }
     return summary;
 }
 
+// Prebuilt instantiations, selected at run time with dispatch_textrank
+template class TextRank<Similarity::Overlap, Normalization::Out_Weight>;
+template class TextRank<Similarity::Overlap, Normalization::Symmetric>;
+template class TextRank<Similarity::Compat, Normalization::Out_Weight>;
+template class TextRank<Similarity::Compat, Normalization::Symmetric>;
+template class TextRank<Similarity::Cosine, Normalization::Out_Weight>;
+template class TextRank<Similarity::Cosine, Normalization::Symmetric>;
+template class TextRank<Similarity::BM25, Normalization::Out_Weight>;
+template class TextRank<Similarity::BM25, Normalization::Symmetric>;
@@ -26,6 +26,30 @@
 #include <algorithm>
 #endif
 
+#ifndef LIMITS
+#define LIMITS
+#include <limits>
+#endif
+
+#ifndef STDEXCEPT
+#define STDEXCEPT
+#include <stdexcept>
+#endif
+
+#ifndef RANGES
+#define RANGES
+#include <ranges>
+#endif
+
+#ifndef TYPE_TRAITS
+#define TYPE_TRAITS
+#include <type_traits>
+#endif
+
+#include "SimilarityKernel.hpp"
+#include "Normalization.hpp"
+#include "Parallel.hpp"
+
 
 
 struct TextRank_Node {
@@ -33,8 +57,21 @@ struct TextRank_Node {
     double norm_constant;
     size_t sent_index;
     std::vector< std::pair<size_t, double> > edges;
+    double weight = 1;      // share of the random jump, 1 unless set with set_node_weights
 };
 
+// Limits of the TextRank graph, the default builds the exact graph of all pairs of sentences
+struct Graph_Limits {
+    size_t max_edges = 0;       // sparsified graph, every sentence keeps its most similar neighbours (0 = all)
+    size_t max_postings = 0;    // approximate graph, only sentences sharing a word found in at most this many
+                                // sentences are compared, instead of all pairs (0 = all pairs)
+};
+
+// SimilarityPolicy computes the weights of the edges while the graph is built (see SimilarityKernel.hpp)
+// NormalizationPolicy turns them into the weights used by the iterations (see Normalization.hpp)
+// Both are compile-time parameters so they are inlined into the inner loops,
+// the prebuilt combinations are instantiated in TextRank.cpp and selected at run time with dispatch_textrank
+template <typename SimilarityPolicy = Similarity::Overlap, typename NormalizationPolicy = Normalization::Out_Weight>
 class TextRank {
     using strVec = std::vector<std::string>;
     using phraseVector = std::vector< strVec >;
@@ -42,19 +79,52 @@ class TextRank {
     std::vector<TextRank_Node> graph_;
     phraseVector tokenized_sentences_;
     strVec sentences_;
+    Similarity::Corpus corpus_;     // sentences as sorted token ids, input of the similarity kernel
+    Similarity::Row_Probe probe_;   // kept between add_sentence calls, its table grows with the vocabulary
+    Graph_Limits limits_;
+    bool graph_complete_ = false;   // all sentences were added, scores initialized and edges normalized
     bool calculated = false;
+    std::vector<size_t> rank_of_;   // rank_of_[sent_index] = position of the sentence in graph_ once calculated
+
+    bool lazy_convergence_ = false;
+    size_t converged_top_k_ = 0;    // number of top sentences the current scores are valid for, FULL if all of them
+
+    // converged_top_k_ of scores that reached the equilibrium
+    static constexpr size_t FULL = std::numeric_limits<size_t>::max();
+    // Lazy convergence stops once the top k membership did not change for this many iterations
+    static constexpr size_t STABLE_ITERATIONS = 3;
+    static constexpr double DAMPING = 0.85;
+
+    size_t num_threads_ = 1;
+    std::vector<double> next_scores_;   // scratch buffer for the parallel Jacobi sweep
+
+    // The parallel iteration hands out about BLOCKS_PER_THREAD blocks of nodes to every thread so uneven degrees
+    // are balanced, but no block smaller than MIN_ITERATION_BLOCK nodes
+    static constexpr size_t BLOCKS_PER_THREAD = 4;
+    static constexpr size_t MIN_ITERATION_BLOCK = 64;
 
 public:
+    // Similarity policy of the graph, e.g. for Planner::measure
+    using similarity_type = SimilarityPolicy;
+
     // Constructor that exploits forwarding references
     // Enables the user to provide either an r-value or an l-value for both parameters
     // Avoids multiples constructor overloads
     template <typename StrVec, typename PhraseVector>
-    TextRank(StrVec&& sentences, PhraseVector&& tokenized_sentences) {
+    TextRank(StrVec&& sentences, PhraseVector&& tokenized_sentences, Graph_Limits limits = {}) : limits_(limits) {
         tokenized_sentences_ = std::forward<PhraseVector>(tokenized_sentences);
         sentences_ = std::forward<StrVec>(sentences);
         construct_graph();
     }
 
+    // Constructor of an empty graph, filled with add_sentence
+    TextRank() = default;
+
+    // Appends the next sentence of the text, only before the first ranking
+    // With an INCREMENTAL similarity policy its edges are inserted right away, so the graph is built while
+    // the text is still being read, other policies need the whole corpus and build the graph at the first ranking
+    void add_sentence(std::string sentence, strVec tokenized_sentence);
+
     // Returns summary of length calculated by percentage of the overall length of the text
     strVec get_summary(double percent = static_cast<double>(1) / 3);
 
@@ -63,23 +133,63 @@ public:
     // Converts it to size_t after necessary checks
     strVec get_summary(int len_i);
 
+    // Lazy views of the sentences of a summary, the sentences are references into the TextRank and no string is copied
+    // The views are valid until the TextRank is destroyed or ranked again (get_summary, get_scores or another view)
+
+    // Sentences of the summary in the order they appear in the text, like get_summary
+    auto summary_view(double percent = static_cast<double>(1) / 3) { return summary_view_priv(summary_length(percent)); }
+
+    auto summary_view(int len_i) { return summary_view_priv(summary_length(len_i)); }
+
+    // Sentences of the summary from the best one
+    auto ranked_view(double percent = static_cast<double>(1) / 3) { return ranked_view_priv(summary_length(percent)); }
+
+    auto ranked_view(int len_i) { return ranked_view_priv(summary_length(len_i)); }
+
+    // Returns the final score of every sentence, indexed by the position of the sentence in the text
+    std::vector<double> get_scores();
+
+    // Returns the positions in the text of the len best sentences (at most all of them), from the best one
+    // With lazy convergence only the membership of the len best is settled, not their order
+    std::vector<size_t> get_ranking(size_t len);
+
+    // Weights of the sentences, indexed by their position in the text, a sentence of weight w gets w times
+    // the score (1 - d) every node receives from the random jump, e.g. for a sentence standing for repeated copies
+    void set_node_weights(const std::vector<double>& weights);
+
+    // Sets the number of threads used by the iteration, 1 runs the sequential in-place (Gauss-Seidel) update,
+    // more run the Jacobi update which converges to slightly different scores, identical for any count above 1
+    void set_threads(size_t num_threads);
+
+    // With lazy convergence get_summary stops iterating as soon as the set of sentences in the summary is settled
+    // instead of waiting for all the scores to converge, get_scores always runs until full convergence
+    void set_lazy_convergence(bool lazy);
+
 private:
     // Equality for doubles, epsilon defines precision required
     static bool doublesEqual(double a, double b, double epsilon = 1e-9);
 
-    // Calculates the similarity between 2 sentences
-    static double similarity(strVec& sent_1, strVec& sent_2);
-
     // Calculates the normalization constants for each node
     // Normalization Constant = Sum of the weights of all outgoing edges
     void set_norm_constants();
 
     void construct_graph();
 
+    // Edges of a graph with limits_, every sentence keeps the limits_.max_edges best of its candidate pairs,
+    // an edge is kept if it is among the best of either of its sentences
+    void construct_limited_graph(const SimilarityPolicy& similarity);
+
+    // Completes a graph filled with add_sentence
+    void finish_graph();
+
     // A single iteration of the algorithm that incrementally updates node scores
     // Returns the total change in scores during this iteration
     double iteration(double d);
 
+    // Multithreaded Jacobi variant of iteration, node ranges are updated concurrently by team from the previous scores
+    // The change is summed in node order, so results are the same for any number of threads above 1
+    double iteration_parallel(double d, Parallel::Thread_Team& team);
+
     // Comparison function for Nodes to be used by std::set and std::sort
     // First compares scores, then indices
     static bool custom_comp (const TextRank_Node& a, const TextRank_Node& b);
@@ -87,8 +197,86 @@ private:
     // Iterates until scores reach equilibrium
     void iterate();
 
+    // Iterates until the membership of the top k sentences is settled
+    // Stops once it was stable for STABLE_ITERATIONS iterations and the gap between the k-th and the (k+1)-th score
+    // exceeds twice the bound on how much any score can still move, or when the scores reach equilibrium
+    // The bound holds for Jacobi iterations of a CONTRACTIVE normalization, others iterate to full convergence
+    void iterate_top_k(size_t k);
+
+    // Returns the indices of the k best nodes (sorted) and sets gap to the score difference at the boundary
+    std::vector<size_t> top_k_members(size_t k, double& gap) const;
+
+    // Runs the iterations until the top_k best sentences are known and sorts graph_ by scores
+    // Does nothing if the current scores are already good enough
+    void calculate(size_t top_k = FULL);
+
+    // Number of sentences of a summary given by a percentage of the text, throws if the percentage is not in [0, 1]
+    size_t summary_length(double percent) const;
+
+    // Number of sentences of a summary given by the user, throws if negative and warns if longer than the text
+    size_t summary_length(int len_i) const;
+
     // Returns summary of specified number of sentences
     strVec get_summary_priv(size_t len);
+
+    // Scans the sentences in text order and keeps those ranked among the first len
+    auto summary_view_priv(size_t len) {
+        calculate(len);
+        return std::views::iota(static_cast<size_t>(0), sentences_.size())
+               | std::views::filter([this, len](size_t i) { return rank_of_[i] < len; })
+               | std::views::transform([this](size_t i) -> const std::string& { return sentences_[i]; });
+    }
+
+    auto ranked_view_priv(size_t len) {
+        calculate(len);
+        return graph_
+               | std::views::take(len)
+               | std::views::transform([this](const TextRank_Node& node) -> const std::string& {
+                     return sentences_[node.sent_index];
+                 });
+    }
 };
 
+// Prebuilt instantiations, defined in TextRank.cpp
+extern template class TextRank<Similarity::Overlap, Normalization::Out_Weight>;
+extern template class TextRank<Similarity::Overlap, Normalization::Symmetric>;
+extern template class TextRank<Similarity::Compat, Normalization::Out_Weight>;
+extern template class TextRank<Similarity::Compat, Normalization::Symmetric>;
+extern template class TextRank<Similarity::Cosine, Normalization::Out_Weight>;
+extern template class TextRank<Similarity::Cosine, Normalization::Symmetric>;
+extern template class TextRank<Similarity::BM25, Normalization::Out_Weight>;
+extern template class TextRank<Similarity::BM25, Normalization::Symmetric>;
+
+// Names of the policies of the prebuilt instantiations, as accepted by dispatch_textrank
+inline const std::vector<std::string> SIMILARITY_NAMES = {"overlap", "compat", "cosine", "bm25"};
+inline const std::vector<std::string> NORMALIZATION_NAMES = {"out-weight", "symmetric"};
+
+// Calls fn(std::type_identity<TextRank<S, N>>{}) with the prebuilt instantiation whose policies are named
+// similarity and normalization, returns what fn returns
+template <typename Fn>
+decltype(auto) dispatch_textrank(const std::string& similarity, const std::string& normalization, Fn&& fn) {
+    auto with_normalization = [&]<typename S>(std::type_identity<S>) -> decltype(auto) {
+        if (normalization == "out-weight") {
+            return fn(std::type_identity<TextRank<S, Normalization::Out_Weight>>{});
+        }
+        if (normalization == "symmetric") {
+            return fn(std::type_identity<TextRank<S, Normalization::Symmetric>>{});
+        }
+        throw std::runtime_error("Error: Unknown TextRank normalization " + normalization + "!");
+    };
+    if (similarity == "overlap") {
+        return with_normalization(std::type_identity<Similarity::Overlap>{});
+    }
+    if (similarity == "compat") {
+        return with_normalization(std::type_identity<Similarity::Compat>{});
+    }
+    if (similarity == "cosine") {
+        return with_normalization(std::type_identity<Similarity::Cosine>{});
+    }
+    if (similarity == "bm25") {
+        return with_normalization(std::type_identity<Similarity::BM25>{});
+    }
+    throw std::runtime_error("Error: Unknown TextRank similarity " + similarity + "!");
+}
+
 #endif //PROJECT_TEXTRANK_HPP
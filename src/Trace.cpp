@@ -0,0 +1,120 @@
+#include "Trace.hpp"
+
+#ifdef RAKE_TEXTRANK_TRACE
+
+#ifndef STRING
+#define STRING
+#include <string>
+#endif
+
+#ifndef VECTOR
+#define VECTOR
+#include <vector>
+#endif
+
+#ifndef MEMORY
+#define MEMORY
+#include <memory>
+#endif
+
+#ifndef MUTEX
+#define MUTEX
+#include <mutex>
+#endif
+
+#ifndef CHRONO
+#define CHRONO
+#include <chrono>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+namespace Trace {
+    std::atomic<bool> enabled{false};
+
+    namespace {
+        const auto process_start = std::chrono::steady_clock::now();
+
+        // Buffers of all threads that recorded a span, buffers outlive their threads so worker spans can be written
+        std::mutex registry_mutex;
+        std::vector< std::unique_ptr<Thread_Buffer> > registry;
+        std::vector<Thread_Buffer*> free_buffers;       // buffers of exited threads
+
+        // Nanoseconds as microseconds with three decimals, exact for any duration
+        std::string microseconds(uint64_t ns) {
+            std::string fraction = std::to_string(ns % 1000);
+            return std::to_string(ns / 1000) + "." + std::string(3 - fraction.size(), '0') + fraction;
+        }
+    }
+
+    // Nanoseconds since the start of the process, monotonic
+    uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - process_start).count());
+    }
+
+    // Buffer of the calling thread, registered on first use and kept after the thread exits
+    // Buffers of exited threads are reused by new threads, so short-lived workers share a few timeline rows
+    Thread_Buffer& thread_buffer() {
+        struct Owner {
+            Thread_Buffer* buffer = nullptr;
+
+            ~Owner() {
+                if (buffer != nullptr) {
+                    std::lock_guard<std::mutex> lock(registry_mutex);
+                    free_buffers.push_back(buffer);
+                }
+            }
+        };
+        thread_local Owner owner;
+        if (owner.buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            if (!free_buffers.empty()) {
+                owner.buffer = free_buffers.back();
+                free_buffers.pop_back();
+            }
+            else {
+                registry.push_back(std::make_unique<Thread_Buffer>());
+                owner.buffer = registry.back().get();
+                owner.buffer->thread_id = registry.size();
+            }
+        }
+        return *owner.buffer;
+    }
+
+    // Starts recording spans
+    void enable() {
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    // Writes the spans of all threads as a Chrome trace-event JSON document
+    // Must not run concurrently with threads recording spans
+    void write_json(std::ostream& out_stream) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        out_stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto& buffer : registry) {
+            size_t written = buffer->written.load(std::memory_order_acquire);
+            size_t begin = written - std::min(written, Thread_Buffer::CAPACITY);
+            for (size_t i = begin; i < written; i++) {
+                const Event& event = buffer->events[i % Thread_Buffer::CAPACITY];
+                // complete events, timestamps in microseconds; names are literals without characters to escape
+                out_stream << (first ? "\n" : ",\n")
+                           << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+                           << ",\"ts\":" << microseconds(event.begin)
+                           << ",\"dur\":" << microseconds(event.end - event.begin) << "}";
+                first = false;
+            }
+            if (written > Thread_Buffer::CAPACITY) {
+                std::cerr << "Warning: " << written - Thread_Buffer::CAPACITY << " oldest spans of thread "
+                          << buffer->thread_id << " were overwritten" << std::endl;
+            }
+        }
+        out_stream << "\n]}" << std::endl;
+    }
+}
+
+#endif
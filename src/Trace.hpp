@@ -0,0 +1,109 @@
+#ifndef PROJECT_TRACE_HPP
+#define PROJECT_TRACE_HPP
+
+// Timeline of the pipeline in Chrome trace-event format, viewable in Perfetto or chrome://tracing
+// Compiled in with the CMake option RAKE_TEXTRANK_TRACE, otherwise TRACE_SCOPE expands to nothing
+// and Trace::compiled is false
+
+#ifndef IOSTREAM
+#define IOSTREAM
+#include <iostream>
+#endif
+
+#ifdef RAKE_TEXTRANK_TRACE
+
+#ifndef ATOMIC
+#define ATOMIC
+#include <atomic>
+#endif
+
+#ifndef CSTDINT
+#define CSTDINT
+#include <cstdint>
+#endif
+
+namespace Trace {
+    constexpr bool compiled = true;
+
+    // A finished span, times in nanoseconds since the start of the process
+    struct Event {
+        const char* name;       // string literal
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // Spans of one thread, only written by that thread
+    // When full the oldest spans are overwritten, written counts all spans ever recorded
+    struct Thread_Buffer {
+        static constexpr size_t CAPACITY = 1 << 16;
+
+        Event events[CAPACITY];
+        std::atomic<size_t> written{0};
+        size_t thread_id = 0;
+    };
+
+    extern std::atomic<bool> enabled;
+
+    // Nanoseconds since the start of the process, monotonic
+    uint64_t now();
+
+    // Buffer of the calling thread, registered on first use and kept after the thread exits
+    Thread_Buffer& thread_buffer();
+
+    // Starts recording spans
+    void enable();
+
+    // Writes the spans of all threads as a Chrome trace-event JSON document
+    // Must not run concurrently with threads recording spans
+    void write_json(std::ostream& out_stream);
+
+    // Records the lifetime of the scope as a span of the calling thread
+    class Scope {
+        const char* name_;
+        uint64_t begin_ = 0;
+
+    public:
+        explicit Scope(const char* name) : name_(name) {
+            if (enabled.load(std::memory_order_relaxed)) {
+                begin_ = now();
+            }
+            else {
+                name_ = nullptr;
+            }
+        }
+
+        ~Scope() {
+            if (name_ == nullptr) {
+                return;
+            }
+            Thread_Buffer& buffer = thread_buffer();
+            size_t written = buffer.written.load(std::memory_order_relaxed);
+            buffer.events[written % Thread_Buffer::CAPACITY] = {name_, begin_, now()};
+            buffer.written.store(written + 1, std::memory_order_release);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+}
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+// Records the rest of the enclosing scope as a span named name (a string literal)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#else
+
+namespace Trace {
+    constexpr bool compiled = false;
+
+    inline void enable() {}
+
+    inline void write_json(std::ostream&) {}
+}
+
+#define TRACE_SCOPE(name)
+
+#endif
+
+#endif //PROJECT_TRACE_HPP
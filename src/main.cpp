@@ -33,6 +33,36 @@
 #include <variant>
 #endif
 
+#ifndef CMATH
+#define CMATH
+#include <cmath>
+#endif
+
+#ifndef CHRONO
+#define CHRONO
+#include <chrono>
+#endif
+
+#ifndef ALGORITHM
+#define ALGORITHM
+#include <algorithm>
+#endif
+
+#ifndef THREAD
+#define THREAD
+#include <thread>
+#endif
+
+#ifndef MUTEX
+#define MUTEX
+#include <mutex>
+#endif
+
+#ifndef CONDITION_VARIABLE
+#define CONDITION_VARIABLE
+#include <condition_variable>
+#endif
+
 #include <boost/program_options.hpp>
 
 
@@ -40,6 +70,13 @@
 #include "TextPreprocess.hpp"
 #include "Rake.hpp"
 #include "TextRank.hpp"
+#include "HierarchicalTextRank.hpp"
+#include "Parallel.hpp"
+#include "StreamingRake.hpp"
+#include "Trace.hpp"
+#include "Pipeline.hpp"
+#include "Deduplication.hpp"
+#include "Planner.hpp"
 
 
 constexpr char PATH_SEP = std::filesystem::path::preferred_separator;
@@ -67,46 +104,269 @@ void validate_program_options(boost::program_options::variables_map& vm) {
         std::cerr << "Error: options <length> and <percent> are mutually exclusive, choose one!" << std::endl;
         exit(2);
     }
+
+    if ((vm.count("snapshot") || vm.count("merge-snapshots")) && !vm.count("rake")) {
+        std::cerr << "Error: options <snapshot> and <merge-snapshots> require <rake>!" << std::endl;
+        exit(2);
+    }
+
+    if (vm.count("merge-snapshots") && vm.count("input-file")) {
+        std::cerr << "Error: options <merge-snapshots> and <input-file> are mutually exclusive, choose one!" << std::endl;
+        exit(2);
+    }
+
+    if (vm.count("pipeline") && (!vm.count("text-rank") || vm.count("hierarchical"))) {
+        std::cerr << "Error: option <pipeline> requires <text-rank> and cannot be combined with <hierarchical>!" << std::endl;
+        exit(2);
+    }
+
+    if (vm.count("dedup") && (!vm.count("text-rank") || vm.count("hierarchical") || vm.count("pipeline"))) {
+        std::cerr << "Error: option <dedup> requires <text-rank> and cannot be combined with <hierarchical> or <pipeline>!" << std::endl;
+        exit(2);
+    }
+
+    if ((vm.count("max-memory") || vm.count("deadline-ms")) && (!vm.count("text-rank") || vm.count("hierarchical") || vm.count("pipeline"))) {
+        std::cerr << "Error: options <max-memory> and <deadline-ms> require <text-rank> and cannot be combined with <hierarchical> or <pipeline>!" << std::endl;
+        exit(2);
+    }
+
+    if (vm.count("stream") && !vm.count("rake")) {
+        std::cerr << "Error: option <stream> requires <rake>!" << std::endl;
+        exit(2);
+    }
+
+    if (vm.count("stream") && (vm.count("snapshot") || vm.count("merge-snapshots") || vm.count("adjoined") || vm.count("percent"))) {
+        std::cerr << "Error: option <stream> cannot be combined with <snapshot>, <merge-snapshots>, <adjoined> or <percent>!" << std::endl;
+        exit(2);
+    }
+
+    if (!vm.count("stream") && (vm.count("report-bytes") || vm.count("report-seconds") || vm.count("decay")
+                                || vm.count("capacity") || vm.count("sketch-width"))) {
+        std::cerr << "Error: options <report-bytes>, <report-seconds>, <decay>, <capacity> and <sketch-width> require <stream>!" << std::endl;
+        exit(2);
+    }
+
+    if (vm.count("hierarchical") && !vm.count("text-rank")) {
+        std::cerr << "Error: option <hierarchical> requires <text-rank>!" << std::endl;
+        exit(2);
+    }
 }
 
-std::vector< std::vector<std::string> > perform_rake(std::vector< std::vector<std::string> >&& phrases,
-                                                     Length_Mode length_mode,
-                                                     std::variant<std::monostate, double, int> length_val) {
-    RAKE rk(std::move(phrases));
-    std::vector< std::vector<std::string> > key_phrases;
+// Writes the key phrases of rk matching the length mode straight from its lazy view
+void output_rake(std::ostream& out_stream, RAKE& rk, Length_Mode length_mode,
+                 std::variant<std::monostate, double, int> length_val) {
     if (length_mode == LENGTH) {
-        key_phrases = rk.get_key_phrases(std::get<int>(length_val));
+        TextProcess::output_range(out_stream, rk.key_phrases_view(std::get<int>(length_val)));
     }
     else if (length_mode == PERCENT) {
-        key_phrases = rk.get_key_phrases(std::get<double>(length_val));
+        TextProcess::output_range(out_stream, rk.key_phrases_view(std::get<double>(length_val)));
     }
     else {
-        key_phrases = rk.get_key_phrases();
+        TextProcess::output_range(out_stream, rk.key_phrases_view());
     }
-    return key_phrases;
 }
 
-std::vector<std::string> perform_textrank(std::vector<std::string>&& sentences,
-                                                         std::vector<std::vector<std::string>>&& processed_sentences,
-                                                         Length_Mode length_mode,
-                                                         std::variant<std::monostate, double, int> length_val) {
-    TextRank tk(std::move(sentences), std::move(processed_sentences));
+// Writes the summary of a TextRank matching the length mode straight from its lazy view
+template <typename TextRank_Type>
+void output_textrank(std::ostream& out_stream, TextRank_Type& tk, Length_Mode length_mode,
+                     std::variant<std::monostate, double, int> length_val) {
+    if (length_mode == LENGTH) {
+        TextProcess::output_range(out_stream, tk.summary_view(std::get<int>(length_val)));
+    }
+    else if (length_mode == PERCENT) {
+        TextProcess::output_range(out_stream, tk.summary_view(std::get<double>(length_val)));
+    }
+    else {
+        TextProcess::output_range(out_stream, tk.summary_view());
+    }
+}
+
+// Calls the get_summary overload of summarizer matching the length mode
+template <typename Summarizer>
+std::vector<std::string> summarize(Summarizer& summarizer, Length_Mode length_mode,
+                                   std::variant<std::monostate, double, int> length_val) {
     std::vector< std::string> summary;
     if (length_mode == LENGTH) {
-        summary = tk.get_summary(std::get<int>(length_val));
+        summary = summarizer.get_summary(std::get<int>(length_val));
     }
     else if (length_mode == PERCENT) {
-        summary = tk.get_summary(std::get<double>(length_val));
+        summary = summarizer.get_summary(std::get<double>(length_val));
     }
     else {
-        summary = tk.get_summary();
+        summary = summarizer.get_summary();
     }
     return summary;
 }
 
+// Number of sentences of the summary of a text of num sentences matching the length mode, like get_summary
+size_t summary_length(Length_Mode length_mode, std::variant<std::monostate, double, int> length_val, size_t num) {
+    if (length_mode == LENGTH) {
+        return std::min(static_cast<size_t>(std::max(0, std::get<int>(length_val))), num);
+    }
+    double percent = length_mode == PERCENT ? std::get<double>(length_val) : static_cast<double>(1) / 3;
+    return static_cast<size_t>(static_cast<double>(num) * percent);
+}
+
+// Feeds the stream to rk and outputs its top len phrases every report_bytes bytes and every report_seconds seconds
+// (0 = never, a timer thread reports also while no input arrives) and at the end of the stream,
+// reports are separated by an empty line
+// The statistics are multiplied by decay after each report
+void perform_streaming_rake(Streaming_RAKE& rk, std::istream& in_stream, std::ostream& out_stream, size_t len,
+                            size_t report_bytes, double report_seconds, double decay) {
+    using Clock = std::chrono::steady_clock;
+    const size_t CHUNK_BYTES = 4096;    // input is fed at every new line or after this many bytes
+
+    // the statistics, the byte count and the time of the last report are shared with the timer thread
+    std::mutex mutex;
+    std::condition_variable stop;
+    bool done = false;
+    auto last_report = Clock::now();
+    size_t bytes = 0;
+
+    auto report = [&]() {
+        bytes = 0;
+        last_report = Clock::now();
+        TextProcess::output_to_stream(out_stream, rk.get_key_phrases(len));
+        out_stream << std::endl;
+        if (decay != 1) {
+            rk.decay(decay);
+        }
+    };
+
+    // time based reports come from a thread of their own, so they are written also while no input arrives
+    std::thread timer;
+    if (report_seconds > 0) {
+        timer = std::thread([&]() {
+            auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(report_seconds));
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stop.wait_until(lock, last_report + period, [&]() { return done; })) {
+                if (Clock::now() >= last_report + period) {
+                    report();
+                }
+            }
+        });
+    }
+    // stops the timer also if feeding throws
+    struct Timer_Stop {
+        std::mutex& mutex;
+        std::condition_variable& stop;
+        bool& done;
+        std::thread& timer;
+
+        ~Timer_Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+            }
+            stop.notify_one();
+            if (timer.joinable()) {
+                timer.join();
+            }
+        }
+    } timer_stop{mutex, stop, done, timer};
+
+    std::string chunk;
+    auto feed_chunk = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (char ch : chunk) {
+            rk.feed(ch);
+            bytes++;
+            if (report_bytes > 0 && bytes == report_bytes) {
+                report();
+            }
+        }
+        chunk.clear();
+    };
+
+    std::streambuf* buffer = in_stream.rdbuf();
+    for (auto c = buffer->sbumpc(); c != std::streambuf::traits_type::eof(); c = buffer->sbumpc()) {
+        char ch = std::streambuf::traits_type::to_char_type(c);
+        chunk.push_back(ch);
+        if (ch == '\n' || chunk.size() >= CHUNK_BYTES) {
+            feed_chunk();
+        }
+    }
+    feed_chunk();
+
+    // done is set under the same lock as the final report, so the timer cannot report after it
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    rk.finish();
+    TextProcess::output_to_stream(out_stream, rk.get_key_phrases(len));
+}
+
+template <typename TextRank_Type>
+void perform_textrank(std::ostream& out_stream,
+                      std::vector<std::string>&& sentences,
+                      std::vector<std::vector<std::string>>&& processed_sentences,
+                      Length_Mode length_mode,
+                      std::variant<std::monostate, double, int> length_val,
+                      size_t num_threads,
+                      bool lazy_convergence,
+                      const std::vector<double>& node_weights,
+                      Graph_Limits limits) {
+    TextRank_Type tk(std::move(sentences), std::move(processed_sentences), limits);
+    if (!node_weights.empty()) {
+        tk.set_node_weights(node_weights);
+    }
+    tk.set_threads(num_threads);
+    tk.set_lazy_convergence(lazy_convergence);
+    output_textrank(out_stream, tk, length_mode, length_val);
+}
+
+// TextRank whose graph is built while the input is read and tokenized
+template <typename TextRank_Type>
+void perform_pipelined_textrank(std::ostream& out_stream,
+                                std::istream& in_stream,
+                                const std::unordered_set<char>& stop_chars,
+                                const std::unordered_set<std::string>& stop_words,
+                                Length_Mode length_mode,
+                                std::variant<std::monostate, double, int> length_val,
+                                size_t num_threads,
+                                bool lazy_convergence) {
+    TextRank_Type tk;
+    Pipeline::feed_sentences(in_stream, sent_end_chars, stop_chars, stop_words, tk);
+    tk.set_threads(num_threads);
+    tk.set_lazy_convergence(lazy_convergence);
+    output_textrank(out_stream, tk, length_mode, length_val);
+}
+
+template <typename TextRank_Type>
+std::vector<std::string> perform_hierarchical_textrank(TextProcess::Sectioned_Text&& text,
+                                                       std::vector<std::vector<std::string>>&& processed_sentences,
+                                                       Length_Mode length_mode,
+                                                       std::variant<std::monostate, double, int> length_val,
+                                                       size_t num_threads,
+                                                       bool lazy_convergence,
+                                                       const std::vector<double>& node_weights) {
+    Hierarchical_TextRank<TextRank_Type> tk(std::move(text.sentences), std::move(processed_sentences),
+                                            std::move(text.section_starts));
+    if (!node_weights.empty()) {
+        tk.set_node_weights(node_weights);
+    }
+    tk.set_threads(num_threads);
+    tk.set_lazy_convergence(lazy_convergence);
+    return summarize(tk, length_mode, length_val);
+}
 
 int main(int argc, char* argv[]) {
     std::string input_file, output_file;
+    size_t num_threads = 1;
+    std::string similarity_name = "overlap";
+    std::string normalization_name = "out-weight";
+    std::string sections_name = "headings";
+    size_t section_size = 100;
+    std::vector<std::string> snapshot_files;
+    size_t min_adjoined_count = 0;
+    size_t report_bytes = 1 << 20;
+    double report_seconds = 0;
+    double decay = 1;
+    size_t stream_capacity = 10000;
+    size_t sketch_width = 1 << 16;
+    std::string trace_file;
+    unsigned dedup_distance = Deduplication::MAX_DISTANCE;
+    std::string max_memory_str;
+    Planner::Budget budget;
     Length_Mode length_mode;
     std::variant<std::monostate, double, int> length_val;
 
@@ -118,7 +378,28 @@ int main(int argc, char* argv[]) {
             ("rake", "produce key phrases using RAKE")
             ("text-rank", "produce a summary using TextRank")
             ("length", boost::program_options::value<int>(), "number of lexical units included in the summary")
-            ("percent", boost::program_options::value<double>(), "length of the summary as a percentage of the length of the original text");
+            ("percent", boost::program_options::value<double>(), "length of the summary as a percentage of the length of the original text")
+            ("threads", boost::program_options::value<size_t>(&num_threads), "number of threads used by TextRank iterations and RAKE scoring (0 = all hardware threads)")
+            ("similarity", boost::program_options::value<std::string>(&similarity_name), "TextRank sentence similarity: overlap (default), compat (original formula), cosine (TF-IDF) or bm25")
+            ("normalization", boost::program_options::value<std::string>(&normalization_name), "TextRank edge normalization: out-weight (default) or symmetric")
+            ("lazy-convergence", "stop TextRank iterations once the sentences of the summary are settled")
+            ("pipeline", "read, tokenize and insert sentences into the TextRank graph concurrently")
+            ("dedup", boost::program_options::value<unsigned>(&dedup_distance)->implicit_value(Deduplication::MAX_DISTANCE), "collapse sentences whose token SimHashes differ in at most n bits (default 3, at most 3) into one TextRank node")
+            ("max-memory", boost::program_options::value<std::string>(&max_memory_str), "memory budget of the TextRank graph in bytes, K, M or G suffixes allowed; the planner picks the most accurate graph strategy that fits")
+            ("deadline-ms", boost::program_options::value<double>(&budget.deadline_ms), "time budget of the TextRank graph and iterations in milliseconds; the planner picks the most accurate graph strategy that fits")
+            ("hierarchical", "rank sections of the text separately, then rank their best sentences together")
+            ("sections", boost::program_options::value<std::string>(&sections_name), "how hierarchical TextRank splits the text: headings (default), blank-lines or fixed")
+            ("section-size", boost::program_options::value<size_t>(&section_size), "sentences per section of hierarchical TextRank (default 100)")
+            ("adjoined", boost::program_options::value<size_t>(&min_adjoined_count), "RAKE also ranks phrases joined by a single stop word (e.g. axis of evil) seen at least n times (default 0 = off)")
+            ("snapshot", "output the RAKE statistics of the input as a snapshot instead of key phrases")
+            ("merge-snapshots", boost::program_options::value<std::vector<std::string>>(&snapshot_files)->multitoken(), "merge RAKE snapshot files instead of reading a text")
+            ("stream", "RAKE over an unbounded stream in constant memory, reporting the current key phrases periodically")
+            ("report-bytes", boost::program_options::value<size_t>(&report_bytes), "streaming RAKE reports every n bytes of input (default 1048576, 0 = never)")
+            ("report-seconds", boost::program_options::value<double>(&report_seconds), "streaming RAKE reports every s seconds, also while no input arrives (default 0 = never)")
+            ("decay", boost::program_options::value<double>(&decay), "streaming RAKE multiplies its statistics by d after each report (default 1 = no decay)")
+            ("capacity", boost::program_options::value<size_t>(&stream_capacity), "number of phrases monitored by streaming RAKE (default 10000)")
+            ("sketch-width", boost::program_options::value<size_t>(&sketch_width), "cells per row of the word statistics sketch of streaming RAKE (default 65536)")
+            ("trace", boost::program_options::value<std::string>(&trace_file), "write a Chrome trace-event timeline of the run to a file (requires a build with RAKE_TEXTRANK_TRACE)");
 
     boost::program_options::variables_map vm;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
@@ -131,6 +412,72 @@ int main(int argc, char* argv[]) {
 
     validate_program_options(vm);
 
+    if (vm.count("trace")) {
+        if (!Trace::compiled) {
+            std::cerr << "Error: option <trace> requires a build with RAKE_TEXTRANK_TRACE enabled!" << std::endl;
+            exit(2);
+        }
+        Trace::enable();
+    }
+
+    if (num_threads == 0) {
+        num_threads = Parallel::hardware_threads();
+    }
+
+    if (std::find(SIMILARITY_NAMES.begin(), SIMILARITY_NAMES.end(), similarity_name) == SIMILARITY_NAMES.end()) {
+        std::cerr << "Error: unknown similarity <" << similarity_name << ">, choose overlap, compat, cosine or bm25!" << std::endl;
+        exit(2);
+    }
+    if (std::find(NORMALIZATION_NAMES.begin(), NORMALIZATION_NAMES.end(), normalization_name) == NORMALIZATION_NAMES.end()) {
+        std::cerr << "Error: unknown normalization <" << normalization_name << ">, choose out-weight or symmetric!" << std::endl;
+        exit(2);
+    }
+
+    if (!(decay > 0 && decay <= 1)) {
+        std::cerr << "Error: <decay> must be in (0, 1]!" << std::endl;
+        exit(2);
+    }
+    if (dedup_distance > Deduplication::MAX_DISTANCE) {
+        std::cerr << "Error: <dedup> distance must be at most " << Deduplication::MAX_DISTANCE << "!" << std::endl;
+        exit(2);
+    }
+    if (vm.count("max-memory")) {
+        try {
+            budget.max_memory = Planner::parse_bytes(max_memory_str);
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            exit(2);
+        }
+    }
+    if (!(budget.deadline_ms > 0)) {
+        std::cerr << "Error: <deadline-ms> must be positive!" << std::endl;
+        exit(2);
+    }
+    if (stream_capacity == 0 || sketch_width == 0) {
+        std::cerr << "Error: <capacity> and <sketch-width> must be positive!" << std::endl;
+        exit(2);
+    }
+
+    TextProcess::Section_Mode section_mode;
+    if (sections_name == "headings") {
+        section_mode = TextProcess::HEADINGS;
+    }
+    else if (sections_name == "blank-lines") {
+        section_mode = TextProcess::BLANK_LINES;
+    }
+    else if (sections_name == "fixed") {
+        section_mode = TextProcess::FIXED;
+    }
+    else {
+        std::cerr << "Error: unknown sections <" << sections_name << ">, choose headings, blank-lines or fixed!" << std::endl;
+        exit(2);
+    }
+    if (section_size == 0) {
+        std::cerr << "Error: <section-size> must be positive!" << std::endl;
+        exit(2);
+    }
+
     // store length or percent into length_val variant
     // leave as std::monostate if both length and percent were not provided
     if (vm.count("length")) {
@@ -182,21 +529,134 @@ int main(int argc, char* argv[]) {
     auto stop_chars = TextProcess::load_stop_chars(STOP_CHARS_PATH);
     auto stop_words = TextProcess::load_stop_words(STOP_WORDS_PATH);
 
-    if (vm.count("rake")) {
-        auto phrases = TextProcess::parse_text_phrases(input_stream, stop_chars, stop_words);
-        TextProcess::output_to_stream(output_stream, perform_rake(std::move(phrases), length_mode, length_val));
+    if (vm.count("rake") && vm.count("stream")) {
+        int len = length_mode == LENGTH ? std::get<int>(length_val) : 10;
+        if (len < 0) {
+            std::cerr << "Error: Length of summary cannot be negative!" << std::endl;
+            exit(2);
+        }
+        Streaming_RAKE rk(stop_chars, stop_words, stream_capacity, sketch_width);
+        perform_streaming_rake(rk, input_stream, output_stream, static_cast<size_t>(len),
+                               report_bytes, report_seconds, decay);
+    }
+
+    else if (vm.count("rake") && !vm.count("snapshot") && !vm.count("merge-snapshots") && min_adjoined_count == 0) {
+        // plain RAKE counts the words itself, on several threads if requested
+        RAKE rk(TextProcess::parse_text_phrases(input_stream, stop_chars, stop_words));
+        rk.set_threads(num_threads);
+        output_rake(output_stream, rk, length_mode, length_val);
+    }
+
+    else if (vm.count("rake")) {
+        // statistics of the whole text, either parsed or merged from the snapshots of its shards
+        Rake_Snapshot snapshot;
+        if (vm.count("merge-snapshots")) {
+            for (const auto& snapshot_file : snapshot_files) {
+                auto snapshot_stream = FileProcess::open_file<std::ifstream>(snapshot_file, std::ios_base::in);
+                snapshot.merge(Rake_Snapshot::deserialize(snapshot_stream));
+            }
+        }
+        else if (min_adjoined_count > 0) {
+            std::vector< std::pair<std::vector<std::string>, size_t> > adjoined;
+            snapshot = Rake_Snapshot(TextProcess::parse_text_phrases_adjoined(input_stream, stop_chars, stop_words, adjoined));
+            snapshot.add_adjoined(adjoined);
+        }
+        else {
+            snapshot = Rake_Snapshot(TextProcess::parse_text_phrases(input_stream, stop_chars, stop_words));
+        }
+
+        if (vm.count("snapshot")) {
+            snapshot.serialize(output_stream);
+        }
+        else {
+            RAKE rk(snapshot, min_adjoined_count);
+            rk.set_threads(num_threads);
+            output_rake(output_stream, rk, length_mode, length_val);
+        }
+    }
+
+    else if (vm.count("text-rank") && vm.count("hierarchical")) {
+        auto text = TextProcess::parse_text_sections(input_stream, sent_end_chars, section_mode, section_size);
+        auto processed_sentences = TextProcess::process_sentences(text.sentences, stop_chars, stop_words);
+        auto summary = dispatch_textrank(similarity_name, normalization_name, [&]<typename T>(std::type_identity<T>) {
+            return perform_hierarchical_textrank<T>(std::move(text), std::move(processed_sentences),
+                                                    length_mode, length_val, num_threads,
+                                                    vm.count("lazy-convergence") > 0, {});
+        });
+        TextProcess::output_to_stream(output_stream, summary);
+    }
+
+    else if (vm.count("text-rank") && vm.count("pipeline")) {
+        dispatch_textrank(similarity_name, normalization_name, [&]<typename T>(std::type_identity<T>) {
+            perform_pipelined_textrank<T>(output_stream, input_stream, stop_chars, stop_words, length_mode, length_val,
+                                          num_threads, vm.count("lazy-convergence") > 0);
+        });
     }
 
     else if (vm.count("text-rank")) {
         auto sentences = TextProcess::parse_text_sentences(input_stream, sent_end_chars);
         auto processed_sentences = TextProcess::process_sentences(sentences, stop_chars, stop_words);
-        TextProcess::output_to_stream(output_stream, perform_textrank(std::move(sentences), std::move(processed_sentences),
-                                                                      length_mode, length_val));
+        // repeated sentences become a single node whose share of the random jump grows with the log of its copies
+        std::vector<double> node_weights;
+        if (vm.count("dedup")) {
+            auto text = Deduplication::collapse_near_duplicates(std::move(sentences), std::move(processed_sentences),
+                                                                dedup_distance);
+            sentences = std::move(text.sentences);
+            processed_sentences = std::move(text.tokenized_sentences);
+            node_weights = Deduplication::node_weights(text.copies);
+        }
+        // with a budget the graph strategy is chosen from statistics sampled from the text with the chosen similarity
+        bool planned = vm.count("max-memory") || vm.count("deadline-ms");
+        bool lazy = vm.count("lazy-convergence") > 0;
+        // the policies are compile-time parameters of TextRank, pick the matching prebuilt instantiation
+        dispatch_textrank(similarity_name, normalization_name, [&]<typename T>(std::type_identity<T>) {
+            Planner::Plan plan;
+            if (planned) {
+                // sections only run concurrently up to the number of cores
+                budget.num_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, num_threads);
+                size_t len = summary_length(length_mode, length_val, sentences.size());
+                plan = Planner::choose(Planner::measure<typename T::similarity_type>(processed_sentences), budget, len);
+                std::cerr << "Plan: " << Planner::describe(plan) << std::endl;
+                if (!plan.within_budget) {
+                    std::cerr << "Warning: no strategy fits the budget, using the cheapest one" << std::endl;
+                }
+            }
+            auto begin = std::chrono::steady_clock::now();
+            if (plan.strategy == Planner::HIERARCHICAL) {
+                // the sections of the fallback are fixed size
+                TextProcess::Sectioned_Text text{std::move(sentences), {}};
+                for (size_t start = 0; start < text.sentences.size(); start += plan.section_size) {
+                    text.section_starts.push_back(start);
+                }
+                auto summary = perform_hierarchical_textrank<T>(std::move(text), std::move(processed_sentences),
+                                                                length_mode, length_val, num_threads, lazy, node_weights);
+                TextProcess::output_to_stream(output_stream, summary);
+            }
+            else {
+                perform_textrank<T>(output_stream, std::move(sentences), std::move(processed_sentences),
+                                    length_mode, length_val, num_threads, lazy, node_weights, plan.limits);
+            }
+            // the estimate is checked against the time the ranking actually took
+            if (planned) {
+                double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                std::cerr << "Plan: took " << static_cast<long long>(std::ceil(elapsed_ms)) << " ms (estimated "
+                          << static_cast<long long>(std::ceil(plan.time_ms)) << " ms)" << std::endl;
+                if (elapsed_ms > budget.deadline_ms) {
+                    std::cerr << "Warning: the ranking took longer than the deadline" << std::endl;
+                }
+            }
+        });
     }
 
     // Close all files if open
     FileProcess::close_files(input_file_stream, output_file_stream);
 
+    if (vm.count("trace")) {
+        auto trace_stream = FileProcess::open_file<std::ofstream>(trace_file, std::ios_base::out);
+        Trace::write_json(trace_stream);
+        trace_stream.close();
+    }
+
     return 0;
 }
 